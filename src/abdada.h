@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "types.h"
+
+// Moves that are being searched right now by any thread, as in ABDADA. A thread
+// searching a move marks the position and move, other threads that pick the same
+// move as a later sibling search it at the end of their move loop instead, when
+// its result is likely in the transposition table already.
+// Lock free: an entry is one atomic key, collisions only make a move not deferred.
+class SearchingMoves {
+   public:
+    [[nodiscard]] static U64 key(U64 hash, Move move) {
+        return hash ^ (U64(move) * 0x9E3779B97F4A7C15ull);
+    }
+
+    /// @brief marks key as searched
+    /// @return false if the entry is in use, the key must not be unmarked then
+    [[nodiscard]] bool mark(U64 key) {
+        U64 expected = 0;
+        return entries_[index(key)].compare_exchange_strong(expected, key,
+                                                            std::memory_order_relaxed);
+    }
+
+    void unmark(U64 key) { entries_[index(key)].store(0, std::memory_order_relaxed); }
+
+    [[nodiscard]] bool isSearched(U64 key) const {
+        return entries_[index(key)].load(std::memory_order_relaxed) == key;
+    }
+
+    // only nodes with this depth are marked, shallower ones are too cheap to share
+    static constexpr int MIN_DEPTH = 4;
+
+   private:
+    static constexpr int SIZE = 1 << 15;
+
+    [[nodiscard]] static int index(U64 key) { return key & (SIZE - 1); }
+
+    std::array<std::atomic<U64>, SIZE> entries_ = {};
+};
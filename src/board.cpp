@@ -75,6 +75,32 @@ Board &Board::operator=(const Board &other) {
     return *this;
 }
 
+void Board::copyPosition(const Board &other) {
+    chess960 = other.chess960;
+
+    state_history_ = other.state_history_;
+
+    pieces_bb_ = other.pieces_bb_;
+    board_ = other.board_;
+
+    occupancy_bb_ = other.occupancy_bb_;
+
+    hash_key_ = other.hash_key_;
+
+    castling_rights_ = other.castling_rights_;
+
+    plies_played_ = other.plies_played_;
+
+    half_move_clock_ = other.half_move_clock_;
+
+    side_to_move_ = other.side_to_move_;
+
+    en_passant_square_ = other.en_passant_square_;
+
+    accumulators_->clear();
+    refreshNNUE();
+}
+
 std::string Board::getCastleString() const {
     std::stringstream ss;
 
@@ -98,20 +124,42 @@ std::string Board::getCastleString() const {
     return ss.str();
 }
 
-void Board::refreshNNUE(nnue::accumulator &acc) const {
-    for (int i = 0; i < N_HIDDEN_SIZE; i++) {
-        acc[WHITE][i] = HIDDEN_BIAS[i];
-        acc[BLACK][i] = HIDDEN_BIAS[i];
-    }
+const nnue::accumulator &Board::getAccumulator() {
+    updateAccumulator(WHITE);
+    updateAccumulator(BLACK);
+
+    return accumulators_->back();
+}
+
+void Board::refreshNNUE() {
+    refreshNNUE(WHITE);
+    refreshNNUE(BLACK);
+}
+
+void Board::refreshNNUE(Color perspective) {
+    accumulators_->refreshCurrent(perspective, builtin::lsb(pieces(KING, perspective)), pieces_bb_);
+}
+
+void Board::updateAccumulator(Color perspective) {
+    const int current = accumulators_->size();
 
-    const Square ksq_white = builtin::lsb(pieces<KING, WHITE>());
-    const Square ksq_black = builtin::lsb(pieces<KING, BLACK>());
+    // walk back to the last computed accumulator
+    int ply = current;
+    while (!accumulators_->isComputed(ply, perspective)) {
+        // nothing to update from, rebuild the current one instead
+        if (ply == 0 || accumulators_->needsRefresh(ply, perspective)) {
+            refreshNNUE(perspective);
+            return;
+        }
+
+        ply--;
+    }
 
-    for (Square i = SQ_A1; i < NO_SQ; i++) {
-        Piece p = board_[i];
-        if (p == NONE) continue;
+    // the king bucket is the same for all plies in between
+    const Square ksq = builtin::lsb(pieces(KING, perspective));
 
-        nnue::activate(acc, i, p, ksq_white, ksq_black);
+    for (ply++; ply <= current; ply++) {
+        accumulators_->update(ply, perspective, ksq);
     }
 }
 
@@ -151,9 +199,6 @@ void Board::setFen(const std::string &fen, bool update_acc) {
         }
     }
 
-    if (update_acc) {
-        refreshNNUE(getAccumulator());
-    }
 
     castling_rights_.clearAllCastlingRights();
 
@@ -189,6 +234,10 @@ void Board::setFen(const std::string &fen, bool update_acc) {
     state_history_.clear();
     accumulators_->clear();
 
+    if (update_acc) {
+        refreshNNUE();
+    }
+
     hash_key_ = zobrist();
 }
 
@@ -250,7 +299,7 @@ std::string Board::getFen() const {
     else
         ss << " " << SQUARE_TO_STRING[en_passant_square_] << " ";
 
-    ss << halfmoves() << " " << fullMoveNumber();
+    ss << static_cast<int>(halfmoves()) << " " << fullMoveNumber();
 
     // Return the resulting FEN string
     return ss.str();
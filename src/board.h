@@ -16,6 +16,7 @@
 
 #include "attacks.h"
 #include "builtin.h"
+#include "evalcache.h"
 #include "helper.h"
 #include "nnue.h"
 #include "tt.h"
@@ -23,6 +24,7 @@
 #include "zobrist.h"
 
 extern TranspositionTable TTable;
+extern EvalCache ECache;
 
 class Board {
    public:
@@ -33,6 +35,10 @@ class Board {
 
     Board &operator=(const Board &other);
 
+    /// @brief takes over the position and its history from other, but keeps the own
+    /// accumulators and refreshes them instead of copying the whole accumulator stack
+    void copyPosition(const Board &other);
+
     [[nodiscard]] U64 hash() const { return hash_key_; }
 
     [[nodiscard]] std::string getCastleString() const;
@@ -49,9 +55,12 @@ class Board {
 
     [[nodiscard]] const CastlingRights &castlingRights() const { return castling_rights_; }
 
-    [[nodiscard]] nnue::accumulator &getAccumulator() { return accumulators_->back(); }
+    /// @brief returns the accumulator of the current position, applies all pending updates
+    /// @return
+    [[nodiscard]] const nnue::accumulator &getAccumulator();
 
-    void refreshNNUE(nnue::accumulator &acc) const;
+    /// @brief rebuilds the current accumulator from scratch
+    void refreshNNUE();
 
     template <typename T = Piece>
     [[nodiscard]] T at(Square sq) const {
@@ -142,14 +151,13 @@ class Board {
     // update the internal board representation
 
     template <bool updateNNUE>
-    void removePiece(Piece piece, Square sq, Square ksq_white = SQ_A1, Square ksq_black = SQ_A1);
+    void removePiece(Piece piece, Square sq);
 
     template <bool updateNNUE>
-    void placePiece(Piece piece, Square sq, Square ksq_white = SQ_A1, Square ksq_black = SQ_A1);
+    void placePiece(Piece piece, Square sq);
 
     template <bool updateNNUE>
-    void movePiece(Piece piece, Square from_sq, Square to_sq, Square ksq_white = SQ_A1,
-                   Square ksq_black = SQ_A1);
+    void movePiece(Piece piece, Square from_sq, Square to_sq);
 
     [[nodiscard]] U64 zobrist() const;
 
@@ -160,6 +168,10 @@ class Board {
     bool chess960 = false;
 
    private:
+    void refreshNNUE(Color perspective);
+
+    void updateAccumulator(Color perspective);
+
     std::unique_ptr<Accumulators> accumulators_ = std::make_unique<Accumulators>();
 
     std::vector<State> state_history_;
@@ -187,32 +199,31 @@ class Board {
 };
 
 template <bool updateNNUE>
-void Board::removePiece(Piece piece, Square sq, Square ksq_white, Square ksq_black) {
+void Board::removePiece(Piece piece, Square sq) {
     pieces_bb_[piece] &= ~(1ULL << sq);
     board_[sq] = NONE;
 
     occupancy_bb_ &= ~(1ULL << sq);
 
     if constexpr (updateNNUE) {
-        nnue::deactivate(getAccumulator(), sq, piece, ksq_white, ksq_black);
+        accumulators_->addDirty(piece, sq, NO_SQ);
     }
 }
 
 template <bool updateNNUE>
-void Board::placePiece(Piece piece, Square sq, Square ksq_white, Square ksq_black) {
+void Board::placePiece(Piece piece, Square sq) {
     pieces_bb_[piece] |= (1ULL << sq);
     board_[sq] = piece;
 
     occupancy_bb_ |= (1ULL << sq);
 
     if constexpr (updateNNUE) {
-        nnue::activate(getAccumulator(), sq, piece, ksq_white, ksq_black);
+        accumulators_->addDirty(piece, NO_SQ, sq);
     }
 }
 
 template <bool updateNNUE>
-void Board::movePiece(Piece piece, Square from_sq, Square to_sq, Square ksq_white,
-                      Square ksq_black) {
+void Board::movePiece(Piece piece, Square from_sq, Square to_sq) {
     pieces_bb_[piece] &= ~(1ULL << from_sq);
     pieces_bb_[piece] |= (1ULL << to_sq);
     board_[from_sq] = NONE;
@@ -222,10 +233,11 @@ void Board::movePiece(Piece piece, Square from_sq, Square to_sq, Square ksq_whit
     occupancy_bb_ |= (1ULL << to_sq);
 
     if constexpr (updateNNUE) {
+        accumulators_->addDirty(piece, from_sq, to_sq);
+
+        // the own perspective has to be refreshed once the king changes its bucket
         if (typeOfPiece(piece) == KING && nnue::KING_BUCKET[from_sq] != nnue::KING_BUCKET[to_sq]) {
-            refreshNNUE(getAccumulator());
-        } else {
-            nnue::move(getAccumulator(), from_sq, to_sq, piece, ksq_white, ksq_black);
+            accumulators_->markRefresh(Color(piece / 6));
         }
     }
 }
@@ -365,9 +377,7 @@ void Board::makeMove(const Move move) {
     updateHash(move);
 
     TTable.prefetch(hash_key_);
-
-    const Square ksq_white = builtin::lsb(pieces<KING, WHITE>());
-    const Square ksq_black = builtin::lsb(pieces<KING, BLACK>());
+    if constexpr (updateNNUE) ECache.prefetch(hash_key_);
 
     // *****************************
     // UPDATE PIECES AND NNUE
@@ -378,20 +388,20 @@ void Board::makeMove(const Move move) {
         Square rook_to_sq = rookCastleSquare(to_sq, from_sq);
         Square king_to_sq = kingCastleSquare(to_sq, from_sq);
 
-        if (updateNNUE && nnue::KING_BUCKET[from_sq] != nnue::KING_BUCKET[king_to_sq]) {
-            removePiece<false>(piece, from_sq, ksq_white, ksq_black);
-            removePiece<false>(rook, to_sq, ksq_white, ksq_black);
+        // the king and rook squares may overlap in chess960, so remove both first
+        removePiece<false>(piece, from_sq);
+        removePiece<false>(rook, to_sq);
 
-            placePiece<false>(piece, king_to_sq, ksq_white, ksq_black);
-            placePiece<false>(rook, rook_to_sq, ksq_white, ksq_black);
+        placePiece<false>(piece, king_to_sq);
+        placePiece<false>(rook, rook_to_sq);
 
-            refreshNNUE(getAccumulator());
-        } else {
-            removePiece<updateNNUE>(piece, from_sq, ksq_white, ksq_black);
-            removePiece<updateNNUE>(rook, to_sq, ksq_white, ksq_black);
+        if constexpr (updateNNUE) {
+            accumulators_->addDirty(piece, from_sq, king_to_sq);
+            accumulators_->addDirty(rook, to_sq, rook_to_sq);
 
-            placePiece<updateNNUE>(piece, king_to_sq, ksq_white, ksq_black);
-            placePiece<updateNNUE>(rook, rook_to_sq, ksq_white, ksq_black);
+            if (nnue::KING_BUCKET[from_sq] != nnue::KING_BUCKET[king_to_sq]) {
+                accumulators_->markRefresh(side_to_move_);
+            }
         }
 
         side_to_move_ = ~side_to_move_;
@@ -401,10 +411,10 @@ void Board::makeMove(const Move move) {
         const auto ep_sq = Square(to_sq ^ 8);
 
         assert(at<PieceType>(ep_sq) == PAWN);
-        removePiece<updateNNUE>(makePiece(PAWN, ~side_to_move_), ep_sq, ksq_white, ksq_black);
+        removePiece<updateNNUE>(makePiece(PAWN, ~side_to_move_), ep_sq);
     } else if (capture != Piece::NONE) {
         assert(at(to_sq) != Piece::NONE);
-        removePiece<updateNNUE>(capture, to_sq, ksq_white, ksq_black);
+        removePiece<updateNNUE>(capture, to_sq);
     }
 
     // The move is differently encoded for promotions to it requires some special care.
@@ -412,13 +422,12 @@ void Board::makeMove(const Move move) {
         // Captured piece is already removed
         assert(at(to_sq) == Piece::NONE);
 
-        removePiece<updateNNUE>(makePiece(PAWN, side_to_move_), from_sq, ksq_white, ksq_black);
-        placePiece<updateNNUE>(makePiece(promotionType(move), side_to_move_), to_sq, ksq_white,
-                               ksq_black);
+        removePiece<updateNNUE>(makePiece(PAWN, side_to_move_), from_sq);
+        placePiece<updateNNUE>(makePiece(promotionType(move), side_to_move_), to_sq);
     } else {
         assert(at(to_sq) == Piece::NONE);
 
-        movePiece<updateNNUE>(piece, from_sq, to_sq, ksq_white, ksq_black);
+        movePiece<updateNNUE>(piece, from_sq, to_sq);
     }
 
     side_to_move_ = ~side_to_move_;
@@ -437,6 +446,7 @@ void Board::unmakeMove(Move move) {
 
     const bool promotion = typeOf(move) == PROMOTION;
 
+    // the accumulator of the previous position is still on the stack
     if (accumulators_->size()) {
         accumulators_->pop();
     }
@@ -458,27 +468,27 @@ void Board::unmakeMove(Move move) {
         const Square king_to_sq = kingCastleSquare(to_sq, from_sq);
 
         // We need to remove both pieces first and then place them back.
-        removePiece<updateNNUE>(rook, rook_from_sq);
-        removePiece<updateNNUE>(makePiece(KING, side_to_move_), king_to_sq);
+        removePiece<false>(rook, rook_from_sq);
+        removePiece<false>(makePiece(KING, side_to_move_), king_to_sq);
 
-        placePiece<updateNNUE>(makePiece(KING, side_to_move_), from_sq);
-        placePiece<updateNNUE>(rook, to_sq);
+        placePiece<false>(makePiece(KING, side_to_move_), from_sq);
+        placePiece<false>(rook, to_sq);
 
         return;
     } else if (promotion) {
-        removePiece<updateNNUE>(makePiece(promotionType(move), side_to_move_), to_sq);
-        placePiece<updateNNUE>(makePiece(PAWN, side_to_move_), from_sq);
+        removePiece<false>(makePiece(promotionType(move), side_to_move_), to_sq);
+        placePiece<false>(makePiece(PAWN, side_to_move_), from_sq);
 
-        if (capture != NONE) placePiece<updateNNUE>(capture, to_sq);
+        if (capture != NONE) placePiece<false>(capture, to_sq);
         return;
     } else {
-        movePiece<updateNNUE>(piece, to_sq, from_sq);
+        movePiece<false>(piece, to_sq, from_sq);
     }
 
     if (to_sq == en_passant_square_ && piece_type == PAWN) {
         const auto ep_sq = Square(en_passant_square_ ^ 8);
-        placePiece<updateNNUE>(makePiece(PAWN, ~side_to_move_), ep_sq);
+        placePiece<false>(makePiece(PAWN, ~side_to_move_), ep_sq);
     } else if (capture != NONE) {
-        placePiece<updateNNUE>(capture, to_sq);
+        placePiece<false>(capture, to_sq);
     }
 }
@@ -7,7 +7,9 @@
 #include "benchmark.h"
 #include "board.h"
 #include "datagen.h"
+#include "evalbatch.h"
 #include "evaluation.h"
+#include "nnue.h"
 #include "perft.h"
 #include "tests/tests.h"
 #include "thread.h"
@@ -99,6 +101,39 @@ class Eval : public Argument {
     }
 };
 
+class EvalBatch : public Argument {
+   public:
+    int parse(int &i, int argc, char const *argv[]) override {
+        std::string input;
+        std::string output;
+        int threads = 1;
+        bool binary = false;
+
+        parseDashArguments(i, argc, argv, [&](const std::string &key, const std::string &value) {
+            if (key == "file") {
+                input = value;
+            } else if (key == "out") {
+                output = value;
+            } else if (key == "threads") {
+                threads = std::stoi(value);
+            } else if (key == "format") {
+                binary = value == "binary";
+            } else {
+                ArgumentsParser::throwMissing("evalbatch", key, value);
+            }
+        });
+
+        const auto t1 = TimePoint::now();
+        const int64_t positions = evalbatch::run(input, output, threads, binary);
+        const auto t2 = TimePoint::now();
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+
+        std::cerr << "Evaluated " << positions << " positions in " << ms << "ms ("
+                  << positions * 1000 / (ms + 1) << " pos/s)" << std::endl;
+        return 1;
+    }
+};
+
 class See : public Argument {
    public:
     int parse(int &i, int argc, char const *argv[]) override {
@@ -157,7 +192,8 @@ class Generate : public Argument {
             }
         });
 
-        TTable.allocateMB(hash_ * workers_);
+        TTable.setThreads(workers_);
+        TTable.allocateMB(U64(hash_) * workers_);
 
         datagen_.generate(workers_, book_path_, depth_, nodes_, use_tb_);
 
@@ -189,6 +225,31 @@ class Generate : public Argument {
     datagen::TrainingData datagen_ = datagen::TrainingData();
 };
 
+class SaveNetwork : public Argument {
+   public:
+    int parse(int &i, int argc, char const *argv[]) override {
+        std::string out;
+
+        parseDashArguments(i, argc, argv, [&](const std::string &key, const std::string &value) {
+            if (key == "in") {
+                nnue::init(value.c_str());
+            } else if (key == "out") {
+                out = value;
+            } else {
+                ArgumentsParser::throwMissing("savenet", key, value);
+            }
+        });
+
+        if (out.empty() || !nnue::save(out.c_str())) {
+            std::cout << "Failed to save the network" << std::endl;
+            return 1;
+        }
+
+        std::cout << "Saved the network to " << out << std::endl;
+        return 1;
+    }
+};
+
 class TestRunner : public Argument {
     int parse(int &, int, char const *[]) override {
         assert(tests::testall());
@@ -205,6 +266,8 @@ ArgumentsParser::ArgumentsParser() {
     addArgument("--v", new Version());
     addArgument("bench", new Benchmark());
     addArgument("-see", new See());
+    addArgument("-evalbatch", new EvalBatch());
     addArgument("-generate", new Generate());
     addArgument("-tests", new TestRunner());
+    addArgument("-savenet", new SaveNetwork());
 }
\ No newline at end of file
@@ -119,7 +119,7 @@ void TrainingData::randomPlayout(std::ofstream &file, Board &board, Movelist &mo
         ply++;
     }
 
-    board.refreshNNUE(board.getAccumulator());
+    board.refreshNNUE();
     search->board = board;
 
     fenData sfens;
@@ -0,0 +1,191 @@
+#include "evalbatch.h"
+
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+#include "evaluation.h"
+#include "str_utils.h"
+
+namespace evalbatch {
+
+// positions read and evaluated at once
+constexpr std::size_t CHUNK_SIZE = 1 << 16;
+
+// Drops everything that isn't part of the fen, like epd operations (";"),
+// training data labels ("[0.5]", "| score") and non numeric move counters.
+static std::string extractFen(const std::string &line) {
+    const std::string position = line.substr(0, line.find_first_of(";[|"));
+    const std::vector<std::string> tokens = str_util::splitString(position, ' ');
+
+    if (tokens.size() < 4) return "";
+
+    std::string fen = tokens[0] + " " + tokens[1] + " " + tokens[2] + " " + tokens[3];
+
+    for (std::size_t i = 4; i < std::min<std::size_t>(tokens.size(), 6); i++) {
+        // longer counters would overflow std::stoi in setFen
+        if (tokens[i].empty() || tokens[i].size() > 4 ||
+            tokens[i].find_first_not_of("0123456789") != std::string::npos) {
+            break;
+        }
+
+        fen += " " + tokens[i];
+    }
+
+    return fen;
+}
+
+// Checks everything setFen relies on, so a malformed line can't crash it.
+static bool isValidFen(const std::string &fen) {
+    const std::vector<std::string> tokens = str_util::splitString(fen, ' ');
+
+    if (tokens.size() < 4) return false;
+
+    int rank = 7;
+    int file = 0;
+    int kings[2] = {0, 0};
+
+    for (const char c : tokens[0]) {
+        if (c == '/') {
+            if (file != 8 || rank == 0) return false;
+
+            rank--;
+            file = 0;
+            continue;
+        }
+
+        if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else {
+            const auto piece = CHAR_TO_PIECE.find(c);
+            if (piece == CHAR_TO_PIECE.end()) return false;
+
+            if (piece->second == WHITEKING) kings[WHITE]++;
+            if (piece->second == BLACKKING) kings[BLACK]++;
+
+            file++;
+        }
+
+        if (file > 8) return false;
+    }
+
+    if (rank != 0 || file != 8 || kings[WHITE] != 1 || kings[BLACK] != 1) return false;
+
+    if (tokens[1] != "w" && tokens[1] != "b") return false;
+
+    if (tokens[2].empty() ||
+        tokens[2].find_first_not_of("-KQkqABCDEFGHabcdefgh") != std::string::npos) {
+        return false;
+    }
+
+    const std::string &ep = tokens[3];
+
+    return ep == "-" ||
+           (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && (ep[1] == '3' || ep[1] == '6'));
+}
+
+int64_t run(const std::string &input, const std::string &output, int threads, bool binary) {
+    std::ifstream input_file;
+    std::ofstream output_file;
+
+    const bool use_stdin = input.empty() || input == "-";
+
+    // stdout also carries the startup messages, the scores need a file of their own
+    if (output.empty() || output == "-") {
+        std::cerr << "evalbatch needs an output file, out=<file>" << std::endl;
+        return 0;
+    }
+
+    if (!use_stdin) {
+        input_file.open(input);
+
+        if (!input_file.is_open()) {
+            std::cerr << "Failed to open " << input << std::endl;
+            return 0;
+        }
+    }
+
+    output_file.open(output, binary ? std::ios::binary : std::ios::out);
+
+    if (!output_file.is_open()) {
+        std::cerr << "Failed to open " << output << std::endl;
+        return 0;
+    }
+
+    std::istream &in = use_stdin ? std::cin : input_file;
+    std::ostream &out = output_file;
+
+    threads = std::max(threads, 1);
+
+    // one board per thread, its accumulators and finny table are reused for all positions
+    std::vector<Board> boards(threads);
+
+    // an empty fen marks an invalid line, it still gets a score so the output lines up
+    std::vector<std::string> fens;
+    std::vector<Score> scores;
+    fens.reserve(CHUNK_SIZE);
+
+    int64_t evaluated = 0;
+    int64_t line_number = 0;
+    std::string line;
+
+    while (in.good()) {
+        fens.clear();
+
+        while (fens.size() < CHUNK_SIZE && std::getline(in, line)) {
+            line_number++;
+
+            std::string fen = extractFen(line);
+
+            if (!isValidFen(fen)) {
+                std::cerr << "Invalid fen on line " << line_number << ": " << line << std::endl;
+                fen.clear();
+            } else {
+                evaluated++;
+            }
+
+            fens.emplace_back(std::move(fen));
+        }
+
+        scores.resize(fens.size());
+
+        auto worker = [&](int id) {
+            Board &board = boards[id];
+
+            for (std::size_t i = id; i < fens.size(); i += threads) {
+                if (fens[i].empty()) {
+                    scores[i] = VALUE_NONE;
+                    continue;
+                }
+
+                board.setFen(fens[i]);
+                scores[i] = eval::evaluate(board);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threads; i++) workers.emplace_back(worker, i);
+        worker(0);
+        for (auto &t : workers) t.join();
+
+        if (binary) {
+            for (const Score score : scores) {
+                const char bytes[2] = {static_cast<char>(score & 0xFF),
+                                       static_cast<char>((score >> 8) & 0xFF)};
+                out.write(bytes, 2);
+            }
+        } else {
+            std::string text;
+            for (const Score score : scores) text += std::to_string(score) + "\n";
+            out << text;
+        }
+    }
+
+    out.flush();
+
+    return evaluated;
+}
+
+}  // namespace evalbatch
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+namespace evalbatch {
+
+/// @brief evaluates every position of a fen/epd file and writes one score per input line,
+/// in the order of the input. Scores are raw evaluations from the side to move, unlike the
+/// centipawns of -eval. Invalid lines are reported on stderr and get VALUE_NONE.
+/// @param input path of the file, "-" or empty reads from stdin
+/// @param output path of the output file, required since stdout carries startup messages
+/// @param threads number of threads evaluating in parallel
+/// @param binary write little endian int16 scores instead of one score per line
+/// @return number of evaluated positions
+int64_t run(const std::string &input, const std::string &output, int threads, bool binary);
+
+}  // namespace evalbatch
@@ -0,0 +1,20 @@
+#include "evalcache.h"
+
+EvalCache::EvalCache() { allocateMB(DEFAULT_MB); }
+
+void EvalCache::allocateMB(U64 size_mb) {
+    const U64 size = size_mb * 1024 * 1024 / sizeof(std::atomic<U64>);
+
+    if (size == size_) return;
+
+    entries_.reset(size ? new std::atomic<U64>[size] : nullptr);
+    size_ = size;
+
+    clear();
+}
+
+void EvalCache::clear() {
+    for (U64 i = 0; i < size_; i++) {
+        entries_[i].store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "builtin.h"
+#include "types.h"
+
+/// @brief Lock free cache of the raw network output, shared by all threads.
+/// The value and the lower key bits (the index uses the upper ones) are packed into a
+/// single 64 bit word, so a torn entry can't be read.
+class EvalCache {
+   public:
+    EvalCache();
+
+    /// @brief looks up the network output of a position
+    /// @param key Position hash
+    /// @param value set to the cached network output on a hit
+    /// @return true on a hit
+    [[nodiscard]] bool probe(U64 key, int32_t &value) const {
+        if (size_ == 0) return false;
+
+        const U64 data = entries_[index(key)].load(std::memory_order_relaxed);
+
+        if (static_cast<uint32_t>(data) != static_cast<uint32_t>(key)) return false;
+
+        value = static_cast<int32_t>(static_cast<uint32_t>(data >> 32));
+        return true;
+    }
+
+    /// @brief stores the network output of a position, always replaces
+    /// @param key Position hash
+    /// @param value
+    void store(U64 key, int32_t value) {
+        if (size_ == 0) return;
+
+        const U64 data = U64(static_cast<uint32_t>(value)) << 32 | static_cast<uint32_t>(key);
+        entries_[index(key)].store(data, std::memory_order_relaxed);
+    }
+
+    void prefetch(U64 key) const {
+        if (size_) builtin::prefetch<0>(&entries_[index(key)]);
+    }
+
+    /// @brief resizes the cache, 0 disables it
+    void allocateMB(U64 size_mb);
+
+    /// @brief clear the cache
+    void clear();
+
+    static constexpr int DEFAULT_MB = 8;
+    static constexpr int MAX_MB = 4096;
+
+   private:
+    [[nodiscard]] U64 index(U64 key) const {
+#ifdef __SIZEOF_INT128__
+        return (uint64_t)(((__uint128_t)key * (__uint128_t)size_) >> 64);
+#else
+        return key % size_;
+#endif
+    }
+
+    std::unique_ptr<std::atomic<U64>[]> entries_;
+    U64 size_ = 0;
+};
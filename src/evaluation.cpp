@@ -5,7 +5,14 @@
 
 namespace eval {
 Score evaluate(Board &board) {
-    int32_t v = nnue::output(board.getAccumulator(), board.sideToMove());
+    int32_t v;
+
+    // a hit also skips updating the accumulator of this position
+    if (!ECache.probe(board.hash(), v)) {
+        v = nnue::output(board.getAccumulator(), board.sideToMove(),
+                         builtin::popcount(board.all()));
+        ECache.store(board.hash(), v);
+    }
 
     v = static_cast<double>(v) * (1.0 - (board.halfmoves() / 1000.0));
     Score score = std::clamp(static_cast<int>(v), (int32_t)(VALUE_MATED_IN_PLY + 1),
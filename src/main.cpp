@@ -1,10 +1,12 @@
 #include "thread.h"
 #include "uci.h"
 #include "cli.h"
+#include "evalcache.h"
 
 // Transposition Table
 // Each entry is 14 bytes large
 TranspositionTable TTable{};
+EvalCache ECache{};
 ThreadPool Threads;
 
 int main(int argc, char const *argv[]) {
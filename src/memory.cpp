@@ -0,0 +1,163 @@
+#include "memory.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <malloc.h>
+#else
+#include <cstdlib>
+#endif
+
+namespace memory {
+
+#if defined(__linux__)
+
+static constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// madvise succeeds even if transparent huge pages are disabled system wide
+static bool transparentHugePagesEnabled() {
+    std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string setting;
+    std::getline(file, setting);
+    return file.good() && setting.find("[never]") == std::string::npos;
+}
+
+Allocation allocateLargePages(std::size_t size) {
+    Allocation allocation;
+    allocation.size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+    constexpr int prot = PROT_READ | PROT_WRITE;
+    constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    // only succeeds if huge pages were reserved, e.g. with vm.nr_hugepages
+    void *mem = mmap(nullptr, allocation.size, prot, flags | MAP_HUGETLB, -1, 0);
+
+    if (mem != MAP_FAILED) {
+        allocation.ptr = mem;
+        allocation.kind = PageKind::HUGETLB;
+        return allocation;
+    }
+
+    mem = mmap(nullptr, allocation.size, prot, flags, -1, 0);
+
+    if (mem == MAP_FAILED) {
+        allocation.size = 0;
+        return allocation;
+    }
+
+    allocation.ptr = mem;
+    allocation.kind = PageKind::REGULAR;
+
+#ifdef MADV_HUGEPAGE
+    if (transparentHugePagesEnabled() && madvise(mem, allocation.size, MADV_HUGEPAGE) == 0) {
+        allocation.kind = PageKind::TRANSPARENT;
+    }
+#endif
+
+    return allocation;
+}
+
+Allocation mapFile(const char *filename) {
+    Allocation allocation;
+
+    const int fd = open(filename, O_RDONLY);
+    if (fd == -1) return allocation;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        close(fd);
+        return allocation;
+    }
+
+    void *mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mem == MAP_FAILED) return allocation;
+
+    allocation.ptr = mem;
+    allocation.size = st.st_size;
+    allocation.kind = PageKind::FILE;
+    return allocation;
+}
+
+void freeLargePages(Allocation &allocation) {
+    if (allocation.ptr) munmap(allocation.ptr, allocation.size);
+    allocation = Allocation();
+}
+
+#else
+
+Allocation allocateLargePages(std::size_t size) {
+    constexpr std::size_t alignment = 64;
+
+    Allocation allocation;
+    allocation.size = (size + alignment - 1) / alignment * alignment;
+
+#ifdef _WIN32
+    allocation.ptr = _aligned_malloc(allocation.size, alignment);
+#else
+    allocation.ptr = std::aligned_alloc(alignment, allocation.size);
+#endif
+
+    if (allocation.ptr) {
+        std::memset(allocation.ptr, 0, allocation.size);
+    } else {
+        allocation.size = 0;
+    }
+
+    return allocation;
+}
+
+Allocation mapFile(const char *filename) {
+    Allocation allocation;
+
+    FILE *f = fopen(filename, "rb");
+    if (f == nullptr) return allocation;
+
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (size > 0) allocation = allocateLargePages(size);
+
+    if (allocation.ptr && fread(allocation.ptr, 1, size, f) != std::size_t(size)) {
+        freeLargePages(allocation);
+    }
+
+    fclose(f);
+    return allocation;
+}
+
+void freeLargePages(Allocation &allocation) {
+#ifdef _WIN32
+    _aligned_free(allocation.ptr);
+#else
+    std::free(allocation.ptr);
+#endif
+    allocation = Allocation();
+}
+
+#endif
+
+const char *pageKindName(PageKind kind) {
+    switch (kind) {
+        case PageKind::HUGETLB:
+            return "huge pages";
+        case PageKind::TRANSPARENT:
+            return "transparent huge pages";
+        case PageKind::FILE:
+            return "a file mapping";
+        default:
+            return "regular pages";
+    }
+}
+
+}  // namespace memory
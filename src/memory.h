@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+namespace memory {
+
+enum class PageKind { HUGETLB, TRANSPARENT, REGULAR, FILE };
+
+struct Allocation {
+    void *ptr = nullptr;
+    std::size_t size = 0;
+    PageKind kind = PageKind::REGULAR;
+};
+
+/// @brief allocates size bytes aligned to at least 64 bytes, backed by huge pages when
+/// possible: explicit MAP_HUGETLB pages first, then transparent huge pages, then regular pages.
+/// The memory is zero initialized.
+/// @param size
+/// @return ptr is nullptr if the allocation failed
+[[nodiscard]] Allocation allocateLargePages(std::size_t size);
+
+/// @brief maps a whole file copy on write, the pages are read on first access and
+/// writes never reach the file. Platforms without mmap read the file into memory instead.
+/// @param filename
+/// @return ptr is nullptr if the file can't be opened
+[[nodiscard]] Allocation mapFile(const char *filename);
+
+/// @brief releases memory of allocateLargePages or mapFile
+void freeLargePages(Allocation &allocation);
+
+/// @brief human readable name of the page kind
+[[nodiscard]] const char *pageKindName(PageKind kind);
+
+}  // namespace memory
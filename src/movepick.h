@@ -26,11 +26,13 @@ class MovePicker {
         movegen::legalmoves<Movetype::CAPTURE>(search_.board, movelist);
     }
 
-    MovePicker(const Search &sh, const Stack *s, Movelist &moves, const Movelist &searchmoves,
+    /// @param rootmoves the root moves of the current line, searched in their order
+    MovePicker(const Search &sh, const Stack *s, Movelist &moves, const Movelist &rootmoves,
                const bool root_node, const Move move)
         : movelist(moves),search_(sh), ss_(s),  available_tt_move_(move) {
-        if (root_node && searchmoves.size > 0) {
-            movelist = searchmoves;
+        if (root_node) {
+            movelist = rootmoves;
+            pick_ = Pick::ROOT;
             return;
         }
         movelist.size = 0;
@@ -135,8 +137,18 @@ class MovePicker {
                     played_++;
                 }
 
+                pick_ = Pick::DEFERRED;
+                [[fallthrough]];
+            case Pick::DEFERRED:
+                if (deferred_played_ < deferred_count_) {
+                    return deferred_[deferred_played_++];
+                }
+
                 return NO_MOVE;
 
+            case Pick::ROOT:
+                return played_ < movelist.size ? movelist[played_++].move : NO_MOVE;
+
             default:
                 return NO_MOVE;
         }
@@ -174,10 +186,20 @@ class MovePicker {
                     history::get<HistoryType::CONST>(move, (ss_ - 2)->currentmove, search_));
     }
 
+    /// @brief returns the move again after all other moves, false if it has to be searched now
+    [[nodiscard]] bool defer(Move move) {
+        if (pick_ == Pick::DEFERRED || deferred_count_ == MAX_DEFERRED) return false;
+
+        deferred_[deferred_count_++] = move;
+        return true;
+    }
+
     Movelist &movelist;
 
    private:
-    enum class Pick { TT, SCORE, CAPTURES, KILLERS_1, KILLERS_2, COUNTER, QUIET };
+    enum class Pick { TT, SCORE, CAPTURES, KILLERS_1, KILLERS_2, COUNTER, QUIET, DEFERRED, ROOT };
+
+    static constexpr int MAX_DEFERRED = 32;
 
     const Search &search_;
     const Stack *ss_;
@@ -192,4 +214,9 @@ class MovePicker {
     Move killer_move_1_ = NO_MOVE;
     Move killer_move_2_ = NO_MOVE;
     Move counter_move_ = NO_MOVE;
+
+    // moves another thread was searching when they were picked
+    std::array<Move, MAX_DEFERRED> deferred_;
+    int deferred_count_ = 0;
+    int deferred_played_ = 0;
 };
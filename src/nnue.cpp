@@ -1,18 +1,60 @@
-
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "nnue.h"
+#include "nnue_simd.h"
 
 #define INCBIN_STYLE INCBIN_STYLE_CAMEL
 
 #include "incbin/incbin.h"
 
+// the kernels are selected at runtime, so align the embedded weights for the widest one
+#undef INCBIN_ALIGNMENT_INDEX
+#define INCBIN_ALIGNMENT_INDEX 6
+
 INCBIN(Eval, EVALFILE);
 
-alignas(32) int16_t INPUT_WEIGHTS[BUCKETS * FEATURE_SIZE * N_HIDDEN_SIZE];
-alignas(32) int16_t HIDDEN_BIAS[N_HIDDEN_SIZE];
-alignas(32) int16_t HIDDEN_WEIGHTS[N_HIDDEN_SIZE * 2];
-alignas(32) int32_t OUTPUT_BIAS[OUTPUTS];
+namespace {
+
+// Owned copy of the weights, only used when the loaded data can't be used in place.
+struct alignas(64) WeightStorage {
+    int16_t input_weights[nnue::Arch::INPUT_WEIGHTS];
+    int16_t hidden_bias[N_HIDDEN_SIZE];
+    int16_t hidden_weights[nnue::Arch::HIDDEN_WEIGHTS];
+    int32_t output_bias[OUTPUTS];
+};
+
+static_assert(offsetof(WeightStorage, output_bias) + sizeof(WeightStorage::output_bias) ==
+              nnue::NetworkHeader::WEIGHTS_SIZE);
+
+WeightStorage storage;
+
+// the currently mapped network file
+void *mapped_data = nullptr;
+std::size_t mapped_size = 0;
+
+// output = (bias + hidden) / OUTPUT_DIVISOR
+int32_t OUTPUT_DIVISOR = nnue::NetworkHeader::DEFAULT_DIVISOR;
+
+// number of networks loaded so far
+int network_version = 0;
+
+}  // namespace
+
+const int16_t *INPUT_WEIGHTS = storage.input_weights;
+const int16_t *HIDDEN_BIAS = storage.hidden_bias;
+const int16_t *HIDDEN_WEIGHTS = storage.hidden_weights;
+const int32_t *OUTPUT_BIAS = storage.output_bias;
 
 namespace nnue {
 
@@ -29,122 +71,309 @@ namespace nnue {
         }
     }
 
-    void activate(nnue::accumulator &accumulator, Square sq, Piece p, Square ksq_white,
-                  Square ksq_black) {
-        const int input_white = idx<WHITE>(sq, p, ksq_white);
-        const int input_black = idx<BLACK>(sq, p, ksq_black);
+    const int16_t *inputWeights(Color perspective, Square sq, Piece p, Square ksq) {
+        const int input = perspective == WHITE ? idx<WHITE>(sq, p, ksq) : idx<BLACK>(sq, p, ksq);
+        return &INPUT_WEIGHTS[input * N_HIDDEN_SIZE];
+    }
 
-        for (int chunks = 0; chunks < N_HIDDEN_SIZE / 256; chunks++) {
-            const int offset = chunks * 256;
+    void update(nnue::accumulator &accumulator, Color perspective, Piece p, Square from_sq,
+                Square to_sq, Square ksq) {
+        int16_t *acc = accumulator[perspective].data();
 
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[0][i] += INPUT_WEIGHTS[input_white * N_HIDDEN_SIZE + i];
-            }
+        if (from_sq == NO_SQ) {
+            simd::kernels.add(acc, inputWeights(perspective, to_sq, p, ksq));
+        } else if (to_sq == NO_SQ) {
+            simd::kernels.sub(acc, inputWeights(perspective, from_sq, p, ksq));
+        } else {
+            simd::kernels.addSub(acc, inputWeights(perspective, to_sq, p, ksq),
+                                 inputWeights(perspective, from_sq, p, ksq));
+        }
+    }
+
+    void update(nnue::accumulator &dst, const nnue::accumulator &src, Color perspective,
+                const DirtyPieces &dirty, Square ksq) {
+        const int16_t *adds[3];
+        const int16_t *subs[3];
+        int add_count = 0;
+        int sub_count = 0;
 
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[1][i] += INPUT_WEIGHTS[input_black * N_HIDDEN_SIZE + i];
+        for (int i = 0; i < dirty.count; i++) {
+            const DirtyPiece &dp = dirty.pieces[i];
+
+            if (dp.to_sq != NO_SQ) {
+                adds[add_count++] = inputWeights(perspective, dp.to_sq, dp.piece, ksq);
+            }
+            if (dp.from_sq != NO_SQ) {
+                subs[sub_count++] = inputWeights(perspective, dp.from_sq, dp.piece, ksq);
             }
         }
+
+        simd::kernels.update(dst[perspective].data(), src[perspective].data(), adds, add_count,
+                             subs, sub_count);
     }
 
-    void deactivate(nnue::accumulator &accumulator, Square sq, Piece p, Square ksq_white,
-                    Square ksq_black) {
-        const int input_white = idx<WHITE>(sq, p, ksq_white);
-        const int input_black = idx<BLACK>(sq, p, ksq_black);
-        for (int chunks = 0; chunks < N_HIDDEN_SIZE / 256; chunks++) {
-            const int offset = chunks * 256;
+    int16_t relu(int16_t x) { return std::max(static_cast<int16_t>(0), x); }
 
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[0][i] -= INPUT_WEIGHTS[input_white * N_HIDDEN_SIZE + i];
-            }
+    int32_t output(const nnue::accumulator &accumulator, Color side, int piece_count) {
+        const int bucket = Arch::outputBucket(piece_count);
 
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[1][i] -= INPUT_WEIGHTS[input_black * N_HIDDEN_SIZE + i];
-            }
+        const int32_t output =
+                OUTPUT_BIAS[bucket] +
+                simd::kernels.output(accumulator[static_cast<int>(side)].data(),
+                                     accumulator[static_cast<int>(~side)].data(),
+                                     &HIDDEN_WEIGHTS[bucket * 2 * N_HIDDEN_SIZE]);
+
+        return output / OUTPUT_DIVISOR;
+    }
+
+    template <typename T>
+    void toHostOrder(T *data, std::size_t count) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        for (std::size_t i = 0; i < count; i++) {
+            auto *bytes = reinterpret_cast<uint8_t *>(&data[i]);
+            std::reverse(bytes, bytes + sizeof(T));
         }
+#else
+        (void)data;
+        (void)count;
+#endif
+    }
+
+    [[nodiscard]] constexpr bool hostIsLittleEndian() {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return false;
+#else
+        return true;
+#endif
     }
 
-    void move(nnue::accumulator &accumulator, Square from_sq, Square to_sq, Piece p, Square ksq_white,
-              Square ksq_black) {
-        const int input_clear_white = idx<WHITE>(from_sq, p, ksq_white);
-        const int input_add_white = idx<WHITE>(to_sq, p, ksq_white);
+    // Converts the weights as stored in the network file into the layout used by the
+    // inference kernels. The file keeps little endian integers. The output kernel multiplies
+    // adjacent int16 pairs of the clipped accumulator and the output weights with madd/vnni,
+    // and clipping is a lane wise max, so the file order already is the kernel order and no
+    // lane interleaving is applied.
+    void transform(WeightStorage &weights) {
+        toHostOrder(weights.input_weights, Arch::INPUT_WEIGHTS);
+        toHostOrder(weights.hidden_bias, N_HIDDEN_SIZE);
+        toHostOrder(weights.hidden_weights, Arch::HIDDEN_WEIGHTS);
+        toHostOrder(weights.output_bias, OUTPUTS);
+    }
 
-        const int input_clear_black = idx<BLACK>(from_sq, p, ksq_black);
-        const int input_add_black = idx<BLACK>(to_sq, p, ksq_black);
+    // the header is stored little endian as well, converting is its own inverse
+    void headerToHostOrder(NetworkHeader &header) {
+        toHostOrder(&header.version, 1);
+        toHostOrder(&header.input_buckets, 1);
+        toHostOrder(&header.feature_size, 1);
+        toHostOrder(&header.hidden_size, 1);
+        toHostOrder(&header.output_buckets, 1);
+        toHostOrder(&header.output_divisor, 1);
+        toHostOrder(&header.hash, 1);
+    }
 
-        for (int chunks = 0; chunks < N_HIDDEN_SIZE / 256; chunks++) {
-            const int offset = chunks * 256;
+    // FNV-1a of the weights following the header
+    uint64_t hashWeights(const uint8_t *data, std::size_t size) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
 
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[0][i] += -INPUT_WEIGHTS[input_clear_white * N_HIDDEN_SIZE + i] +
-                                     INPUT_WEIGHTS[input_add_white * N_HIDDEN_SIZE + i];
-            }
+        for (std::size_t i = 0; i < size; i++) {
+            hash ^= data[i];
+            hash *= 0x100000001b3ULL;
+        }
 
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[1][i] += -INPUT_WEIGHTS[input_clear_black * N_HIDDEN_SIZE + i] +
-                                     INPUT_WEIGHTS[input_add_black * N_HIDDEN_SIZE + i];
+        return hash;
+    }
+
+    NetworkHeader makeHeader(const uint8_t *weights) {
+        NetworkHeader header = {};
+        std::memcpy(header.magic, NetworkHeader::MAGIC, sizeof(header.magic));
+        header.version = NetworkHeader::VERSION;
+        header.input_buckets = Arch::INPUT_BUCKETS;
+        header.feature_size = Arch::FEATURE_SIZE;
+        header.hidden_size = Arch::HIDDEN_SIZE;
+        header.output_buckets = Arch::OUTPUT_BUCKETS;
+        header.output_divisor = OUTPUT_DIVISOR;
+        header.hash = hashWeights(weights, NetworkHeader::WEIGHTS_SIZE);
+        return header;
+    }
+
+    // Checks the header against the compiled architecture, a headerless legacy
+    // file is only identified by its size.
+    bool parseHeader(const uint8_t *&data, std::size_t &size, const char *source) {
+        const bool has_header = size >= sizeof(NetworkHeader) &&
+                                std::memcmp(data, NetworkHeader::MAGIC, 4) == 0;
+
+        if (!has_header) {
+            if (size != NetworkHeader::WEIGHTS_SIZE) {
+                std::cout << "The network was not fully loaded " << source << " " << size << " "
+                          << NetworkHeader::WEIGHTS_SIZE << std::endl;
+                return false;
             }
+
+            OUTPUT_DIVISOR = NetworkHeader::DEFAULT_DIVISOR;
+            return true;
         }
+
+        NetworkHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        headerToHostOrder(header);
+
+        if (header.version != NetworkHeader::VERSION) {
+            std::cout << "Unsupported network version " << header.version << " " << source
+                      << std::endl;
+            return false;
+        }
+
+        if (header.input_buckets != Arch::INPUT_BUCKETS ||
+            header.feature_size != Arch::FEATURE_SIZE || header.hidden_size != Arch::HIDDEN_SIZE ||
+            header.output_buckets != Arch::OUTPUT_BUCKETS) {
+            std::cout << "The network " << source << " has the architecture ("
+                      << header.input_buckets << "x" << header.feature_size << " -> "
+                      << header.hidden_size << ")x2 -> " << header.output_buckets
+                      << ", expected (" << Arch::INPUT_BUCKETS << "x" << Arch::FEATURE_SIZE
+                      << " -> " << Arch::HIDDEN_SIZE << ")x2 -> " << Arch::OUTPUT_BUCKETS
+                      << std::endl;
+            return false;
+        }
+
+        data += sizeof(NetworkHeader);
+        size -= sizeof(NetworkHeader);
+
+        if (size != NetworkHeader::WEIGHTS_SIZE || header.output_divisor <= 0 ||
+            hashWeights(data, size) != header.hash) {
+            std::cout << "The network " << source << " is corrupted" << std::endl;
+            return false;
+        }
+
+        OUTPUT_DIVISOR = header.output_divisor;
+        return true;
     }
 
-    int16_t relu(int16_t x) { return std::max(static_cast<int16_t>(0), x); }
+    void pointWeights(const void *data) {
+        INPUT_WEIGHTS = static_cast<const int16_t *>(data);
+        HIDDEN_BIAS = INPUT_WEIGHTS + Arch::INPUT_WEIGHTS;
+        HIDDEN_WEIGHTS = HIDDEN_BIAS + N_HIDDEN_SIZE;
+        OUTPUT_BIAS = reinterpret_cast<const int32_t *>(HIDDEN_WEIGHTS + Arch::HIDDEN_WEIGHTS);
+    }
 
-    int32_t output(const nnue::accumulator &accumulator, Color side) {
-        int32_t output = OUTPUT_BIAS[0];
+    void copyWeights(const uint8_t *data) {
+        std::memcpy(&storage, data, NetworkHeader::WEIGHTS_SIZE);
+        transform(storage);
+        pointWeights(&storage);
+    }
 
-        for (int chunks = 0; chunks < N_HIDDEN_SIZE / 256; chunks++) {
-            const int offset = chunks * 256;
+    void unmapFile(void *data, std::size_t size) {
+        if (data == nullptr) return;
+#ifndef _WIN32
+        munmap(data, size);
+#else
+        (void)size;
+#endif
+    }
 
-            // two individual loops seem to be faster for auto vectorization
-            for (int i = 0; i < 256; i++) {
-                output +=
-                        relu(accumulator[static_cast<int>(side)][i + offset]) * HIDDEN_WEIGHTS[i + offset];
-            }
+    // Maps the file read only, every engine process on the host shares the same pages.
+    // Returns false if the file can't be mapped.
+    bool mapFile(const char *filename) {
+#ifndef _WIN32
+        const int fd = open(filename, O_RDONLY);
+        if (fd == -1) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) == -1 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
 
-            for (int i = 0; i < 256; i++) {
-                output += relu(accumulator[static_cast<int>(~side)][i + offset]) *
-                          HIDDEN_WEIGHTS[N_HIDDEN_SIZE + i + offset];
-            }
+        void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (data == MAP_FAILED) return false;
+
+        mapped_data = data;
+        mapped_size = st.st_size;
+        return true;
+#else
+        (void)filename;
+        return false;
+#endif
+    }
+
+    // reads the file into memory on platforms without mmap
+    bool readFile(const char *filename, std::vector<uint8_t> &buffer) {
+        FILE *f = fopen(filename, "rb");
+        if (f == nullptr) return false;
+
+        uint8_t chunk[4096];
+        std::size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+            buffer.insert(buffer.end(), chunk, chunk + n);
         }
 
-        return output / (16 * 512);
+        fclose(f);
+        return true;
     }
 
     void init(const char *filename) {
-        FILE *f = fopen(filename, "rb");
+        void *previous_mapping = mapped_data;
+        const std::size_t previous_size = mapped_size;
+        mapped_data = nullptr;
+        mapped_size = 0;
+
+        const uint8_t *data = nullptr;
+        std::size_t size = 0;
+        std::string source = filename;
+        std::vector<uint8_t> buffer;
+
+        if (mapFile(filename)) {
+            data = static_cast<const uint8_t *>(mapped_data);
+            size = mapped_size;
+        } else if (readFile(filename, buffer)) {
+            data = buffer.data();
+            size = buffer.size();
+        } else {
+            // fall back to the network the binary was compiled with
+            data = gEvalData;
+            size = gEvalSize;
+            source = "embedded";
+        }
 
-        // obtain file size
-        std::size_t fileSize = FEATURE_SIZE * N_HIDDEN_SIZE + N_HIDDEN_SIZE + 2 * N_HIDDEN_SIZE + OUTPUTS;
-
-        std::size_t readElements = 0;
-        if (f != nullptr) {
-            readElements +=
-                    fread(INPUT_WEIGHTS, sizeof(int16_t), BUCKETS * FEATURE_SIZE * N_HIDDEN_SIZE, f);
-            readElements += fread(HIDDEN_BIAS, sizeof(int16_t), N_HIDDEN_SIZE, f);
-            readElements += fread(HIDDEN_WEIGHTS, sizeof(int16_t), 2 * N_HIDDEN_SIZE, f);
-            readElements += fread(OUTPUT_BIAS, sizeof(int32_t), OUTPUTS, f);
-
-            if (readElements != fileSize) {
-                std::cout << "The network was not fully loaded"
-                          << " " << readElements << " " << fileSize << std::endl;
-                exit(2);
-            }
+        if (!parseHeader(data, size, source.c_str())) exit(2);
 
-            fclose(f);
+        // the mapped file and the embedded network are used in place,
+        // the read buffer is freed at the end of this function
+        const bool aligned = reinterpret_cast<std::uintptr_t>(data) % 64 == 0;
+
+        if (buffer.empty() && aligned && hostIsLittleEndian()) {
+            pointWeights(data);
         } else {
-            int memoryIndex = 0;
-            std::memcpy(INPUT_WEIGHTS, &gEvalData[memoryIndex],
-                        BUCKETS * FEATURE_SIZE * N_HIDDEN_SIZE * sizeof(int16_t));
-            memoryIndex += BUCKETS * FEATURE_SIZE * N_HIDDEN_SIZE * sizeof(int16_t);
-            std::memcpy(HIDDEN_BIAS, &gEvalData[memoryIndex], N_HIDDEN_SIZE * sizeof(int16_t));
-            memoryIndex += N_HIDDEN_SIZE * sizeof(int16_t);
-
-            std::memcpy(HIDDEN_WEIGHTS, &gEvalData[memoryIndex], 2 * N_HIDDEN_SIZE * sizeof(int16_t));
-            memoryIndex += 2 * N_HIDDEN_SIZE * sizeof(int16_t);
-            std::memcpy(OUTPUT_BIAS, &gEvalData[memoryIndex], 1 * sizeof(int32_t));
-            memoryIndex += OUTPUTS * sizeof(int32_t);
+            copyWeights(data);
         }
 
-        std::cout << "Loaded NNUE network" << std::endl;
+        unmapFile(previous_mapping, previous_size);
+
+        network_version++;
+
+        std::cout << "Loaded NNUE network (" << simd::kernels.name << ")" << std::endl;
+    }
+
+    int networkVersion() { return network_version; }
+
+    bool save(const char *filename) {
+        std::vector<uint8_t> weights(NetworkHeader::WEIGHTS_SIZE);
+        std::memcpy(weights.data(), INPUT_WEIGHTS, NetworkHeader::WEIGHTS_SIZE);
+
+        // back to the little endian file order
+        WeightStorage *file_order = reinterpret_cast<WeightStorage *>(weights.data());
+        transform(*file_order);
+
+        NetworkHeader header = makeHeader(weights.data());
+        headerToHostOrder(header);
+
+        FILE *f = fopen(filename, "wb");
+        if (f == nullptr) return false;
+
+        const bool written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                             fwrite(weights.data(), 1, weights.size(), f) == weights.size();
+
+        fclose(f);
+        return written;
     }
-}  // namespace nnue
\ No newline at end of file
+}  // namespace nnue
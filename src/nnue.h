@@ -7,15 +7,87 @@
 
 #include "types.h"
 
-#define BUCKETS 4
-#define FEATURE_SIZE 64 * 12
-#define N_HIDDEN_SIZE 512
-#define OUTPUTS 1
+// The shape of the network can be changed at build time,
+// e.g. make NNUE_HIDDEN_SIZE=1024 NNUE_OUTPUT_BUCKETS=8
+#ifndef NNUE_HIDDEN_SIZE
+#define NNUE_HIDDEN_SIZE 512
+#endif
 
-extern int16_t INPUT_WEIGHTS[BUCKETS * FEATURE_SIZE * N_HIDDEN_SIZE];
-extern int16_t HIDDEN_BIAS[N_HIDDEN_SIZE];
-extern int16_t HIDDEN_WEIGHTS[N_HIDDEN_SIZE * 2];
-extern int32_t OUTPUT_BIAS[OUTPUTS];
+#ifndef NNUE_OUTPUT_BUCKETS
+#define NNUE_OUTPUT_BUCKETS 1
+#endif
+
+namespace nnue {
+
+// (768 -> HiddenSize) x 2 -> OutputBuckets
+// The input layer has one weight set per king bucket, the output layer
+// one per material bucket.
+template <int InputBuckets, int HiddenSize, int OutputBuckets>
+struct Architecture {
+    static constexpr int INPUT_BUCKETS = InputBuckets;
+    static constexpr int FEATURE_SIZE = 64 * 12;
+    static constexpr int HIDDEN_SIZE = HiddenSize;
+    static constexpr int OUTPUT_BUCKETS = OutputBuckets;
+
+    static constexpr int INPUT_WEIGHTS = INPUT_BUCKETS * FEATURE_SIZE * HIDDEN_SIZE;
+    static constexpr int HIDDEN_WEIGHTS = OUTPUT_BUCKETS * 2 * HIDDEN_SIZE;
+
+    // the kernels process whole avx512 registers of 32 int16 lanes
+    static_assert(HIDDEN_SIZE % 32 == 0, "hidden size has to be a multiple of 32");
+    static_assert(OUTPUT_BUCKETS >= 1 && OUTPUT_BUCKETS <= 32);
+
+    // the output bucket of a position with piece_count pieces on the board
+    [[nodiscard]] static constexpr int outputBucket(int piece_count) {
+        constexpr int divisor = (32 + OUTPUT_BUCKETS - 1) / OUTPUT_BUCKETS;
+        return (piece_count - 2) / divisor;
+    }
+};
+
+using Arch = Architecture<4, NNUE_HIDDEN_SIZE, NNUE_OUTPUT_BUCKETS>;
+
+// Header of a network file, followed by the little endian weights: input weights,
+// hidden bias, hidden weights (int16) and output bias (int32). Files without a
+// header only contain the weights and are identified by their size.
+struct NetworkHeader {
+    static constexpr char MAGIC[4] = {'S', 'B', 'N', 'N'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr int32_t DEFAULT_DIVISOR = 16 * 512;
+
+    static constexpr std::size_t WEIGHTS_SIZE =
+        (Arch::INPUT_WEIGHTS + Arch::HIDDEN_SIZE + Arch::HIDDEN_WEIGHTS) * sizeof(int16_t) +
+        Arch::OUTPUT_BUCKETS * sizeof(int32_t);
+
+    char magic[4];
+    uint32_t version;
+    uint32_t input_buckets;
+    uint32_t feature_size;
+    uint32_t hidden_size;
+    uint32_t output_buckets;
+    // product of the quantization scales over the eval scale,
+    // output = (bias + hidden) / output_divisor
+    int32_t output_divisor;
+    uint32_t reserved;
+    // FNV-1a of the weights
+    uint64_t hash;
+    // keeps the weights 64 byte aligned in the mapped file
+    uint8_t padding[24];
+};
+
+static_assert(sizeof(NetworkHeader) == 64);
+
+}  // namespace nnue
+
+constexpr int BUCKETS = nnue::Arch::INPUT_BUCKETS;
+constexpr int FEATURE_SIZE = nnue::Arch::FEATURE_SIZE;
+constexpr int N_HIDDEN_SIZE = nnue::Arch::HIDDEN_SIZE;
+constexpr int OUTPUTS = nnue::Arch::OUTPUT_BUCKETS;
+
+// The weights either point into the mapped network file, the embedded
+// network or an owned copy.
+extern const int16_t *INPUT_WEIGHTS;  // [INPUT_WEIGHTS]
+extern const int16_t *HIDDEN_BIAS;    // [N_HIDDEN_SIZE]
+extern const int16_t *HIDDEN_WEIGHTS;  // [HIDDEN_WEIGHTS]
+extern const int32_t *OUTPUT_BIAS;     // [OUTPUTS]
 
 namespace nnue {
 
@@ -33,25 +105,49 @@ constexpr int KING_BUCKET[64] {
 
 // clang-format on
 
+// the bucket of a king square, black uses the mirrored square
+[[nodiscard]] constexpr int kingBucket(Color perspective, Square ksq) {
+    return KING_BUCKET[perspective == WHITE ? ksq : ksq ^ 56];
+}
+
 using accumulator = std::array<std::array<int16_t, N_HIDDEN_SIZE>, 2>;
 
+// A piece that changed its square during a move,
+// from_sq == NO_SQ for added pieces and to_sq == NO_SQ for removed ones.
+struct DirtyPiece {
+    Piece piece;
+    Square from_sq;
+    Square to_sq;
+};
+
+// Every move changes at most 3 pieces (capture promotion),
+// castling is recorded as a king and a rook move.
+struct DirtyPieces {
+    std::array<DirtyPiece, 3> pieces;
+    uint8_t count = 0;
+};
+
 [[nodiscard]] int16_t relu(int16_t x);
 
-// load the weights and bias
+// load the weights and bias, the file is mapped if possible,
+// without a file the embedded network is used
 void init(const char *filename);
 
-// activate a certain input and update the accumulator
-void activate(nnue::accumulator &accumulator, Square sq, Piece p, Square ksq_white,
-              Square ksq_black);
+// incremented by every init, caches of values computed from the weights compare it
+[[nodiscard]] int networkVersion();
+
+// write the loaded network with a header, returns false on failure
+bool save(const char *filename);
 
-// deactivate a certain input and update the accumulator
-void deactivate(nnue::accumulator &accumulator, Square sq, Piece p, Square ksq_white,
-                Square ksq_black);
+// apply a single changed piece to one perspective of the accumulator,
+// from_sq == NO_SQ adds the piece, to_sq == NO_SQ removes it
+void update(nnue::accumulator &accumulator, Color perspective, Piece p, Square from_sq,
+            Square to_sq, Square ksq);
 
-// activate and deactivate, mirrors the logic of a move
-void move(nnue::accumulator &accumulator, Square from_sq, Square to_sq, Piece p, Square ksq_white,
-          Square ksq_black);
+// compute one perspective of dst from src and the changed pieces of a move in a single pass
+void update(nnue::accumulator &dst, const nnue::accumulator &src, Color perspective,
+            const DirtyPieces &dirty, Square ksq);
 
-// return the nnue evaluation
-[[nodiscard]] int32_t output(const nnue::accumulator &accumulator, Color side);
+// return the nnue evaluation, piece_count selects the output bucket
+[[nodiscard]] int32_t output(const nnue::accumulator &accumulator, Color side, int piece_count);
 }  // namespace nnue
\ No newline at end of file
@@ -0,0 +1,59 @@
+// No include guard, this file is included once per instruction set by nnue_simd.cpp.
+// The including namespace has to provide:
+//   SIMD_TARGET, SIMD_NAME
+//   vec_t, LANES (int16 lanes per vec_t)
+//   vecLoad, vecStore, vecAdd16, vecSub16, vecMax16, vecZero, vecDotAdd, vecHsum32
+
+static_assert(N_HIDDEN_SIZE % LANES == 0);
+
+SIMD_TARGET static void add(int16_t *acc, const int16_t *weights) {
+    for (int i = 0; i < N_HIDDEN_SIZE; i += LANES) {
+        vecStore(acc + i, vecAdd16(vecLoad(acc + i), vecLoad(weights + i)));
+    }
+}
+
+SIMD_TARGET static void sub(int16_t *acc, const int16_t *weights) {
+    for (int i = 0; i < N_HIDDEN_SIZE; i += LANES) {
+        vecStore(acc + i, vecSub16(vecLoad(acc + i), vecLoad(weights + i)));
+    }
+}
+
+SIMD_TARGET static void addSub(int16_t *acc, const int16_t *add_weights,
+                               const int16_t *sub_weights) {
+    for (int i = 0; i < N_HIDDEN_SIZE; i += LANES) {
+        const vec_t delta = vecSub16(vecLoad(add_weights + i), vecLoad(sub_weights + i));
+        vecStore(acc + i, vecAdd16(vecLoad(acc + i), delta));
+    }
+}
+
+SIMD_TARGET static void update(int16_t *dst, const int16_t *src, const int16_t *const *adds,
+                               int add_count, const int16_t *const *subs, int sub_count) {
+    for (int i = 0; i < N_HIDDEN_SIZE; i += LANES) {
+        vec_t v = vecLoad(src + i);
+        for (int j = 0; j < add_count; j++) v = vecAdd16(v, vecLoad(adds[j] + i));
+        for (int j = 0; j < sub_count; j++) v = vecSub16(v, vecLoad(subs[j] + i));
+        vecStore(dst + i, v);
+    }
+}
+
+SIMD_TARGET static int32_t output(const int16_t *us, const int16_t *them,
+                                  const int16_t *weights) {
+    const vec_t zero = vecZero();
+
+    // two independent sums to hide the latency of the multiply add
+    vec_t sum_us = vecZero();
+    vec_t sum_them = vecZero();
+
+    for (int i = 0; i < N_HIDDEN_SIZE; i += LANES) {
+        sum_us = vecDotAdd(sum_us, vecMax16(vecLoad(us + i), zero), vecLoad(weights + i));
+        sum_them = vecDotAdd(sum_them, vecMax16(vecLoad(them + i), zero),
+                             vecLoad(weights + N_HIDDEN_SIZE + i));
+    }
+
+    return vecHsum32(sum_us) + vecHsum32(sum_them);
+}
+
+static const Kernels KERNELS = {SIMD_NAME, add, sub, addSub, update, output};
+
+#undef SIMD_TARGET
+#undef SIMD_NAME
@@ -0,0 +1,240 @@
+#include "nnue_simd.h"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define USE_X86_DISPATCH
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace nnue::simd {
+
+/********************
+ * Plain C++, used when no vector extension is available
+ *******************/
+namespace scalar {
+
+static void add(int16_t *acc, const int16_t *weights) {
+    for (int i = 0; i < N_HIDDEN_SIZE; i++) acc[i] += weights[i];
+}
+
+static void sub(int16_t *acc, const int16_t *weights) {
+    for (int i = 0; i < N_HIDDEN_SIZE; i++) acc[i] -= weights[i];
+}
+
+static void addSub(int16_t *acc, const int16_t *add_weights, const int16_t *sub_weights) {
+    for (int i = 0; i < N_HIDDEN_SIZE; i++) acc[i] += add_weights[i] - sub_weights[i];
+}
+
+static void update(int16_t *dst, const int16_t *src, const int16_t *const *adds, int add_count,
+                   const int16_t *const *subs, int sub_count) {
+    for (int i = 0; i < N_HIDDEN_SIZE; i++) {
+        int16_t v = src[i];
+        for (int j = 0; j < add_count; j++) v += adds[j][i];
+        for (int j = 0; j < sub_count; j++) v -= subs[j][i];
+        dst[i] = v;
+    }
+}
+
+static int32_t output(const int16_t *us, const int16_t *them, const int16_t *weights) {
+    int32_t sum = 0;
+
+    for (int i = 0; i < N_HIDDEN_SIZE; i++) {
+        sum += std::max<int16_t>(0, us[i]) * weights[i];
+        sum += std::max<int16_t>(0, them[i]) * weights[N_HIDDEN_SIZE + i];
+    }
+
+    return sum;
+}
+
+static const Kernels KERNELS = {"scalar", add, sub, addSub, update, output};
+
+}  // namespace scalar
+
+#ifdef USE_X86_DISPATCH
+
+/********************
+ * The x86 kernels are compiled with function level target attributes,
+ * this way a single binary carries all of them regardless of -march.
+ *******************/
+
+// The 128 bit kernel only needs SSE2, which every x86-64 cpu has.
+namespace sse2 {
+#define SIMD_TARGET __attribute__((target("sse2")))
+#define SIMD_NAME "sse2"
+
+using vec_t = __m128i;
+constexpr int LANES = 8;
+
+SIMD_TARGET inline vec_t vecLoad(const int16_t *p) {
+    return _mm_loadu_si128(reinterpret_cast<const vec_t *>(p));
+}
+SIMD_TARGET inline void vecStore(int16_t *p, vec_t v) {
+    _mm_storeu_si128(reinterpret_cast<vec_t *>(p), v);
+}
+SIMD_TARGET inline vec_t vecAdd16(vec_t a, vec_t b) { return _mm_add_epi16(a, b); }
+SIMD_TARGET inline vec_t vecSub16(vec_t a, vec_t b) { return _mm_sub_epi16(a, b); }
+SIMD_TARGET inline vec_t vecMax16(vec_t a, vec_t b) { return _mm_max_epi16(a, b); }
+SIMD_TARGET inline vec_t vecZero() { return _mm_setzero_si128(); }
+SIMD_TARGET inline vec_t vecDotAdd(vec_t sum, vec_t a, vec_t b) {
+    return _mm_add_epi32(sum, _mm_madd_epi16(a, b));
+}
+SIMD_TARGET inline int32_t vecHsum32(vec_t v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+    return _mm_cvtsi128_si32(v);
+}
+
+#include "nnue_kernels.h"
+}  // namespace sse2
+
+namespace avx2 {
+#define SIMD_TARGET __attribute__((target("avx2")))
+#define SIMD_NAME "avx2"
+
+using vec_t = __m256i;
+constexpr int LANES = 16;
+
+SIMD_TARGET inline vec_t vecLoad(const int16_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const vec_t *>(p));
+}
+SIMD_TARGET inline void vecStore(int16_t *p, vec_t v) {
+    _mm256_storeu_si256(reinterpret_cast<vec_t *>(p), v);
+}
+SIMD_TARGET inline vec_t vecAdd16(vec_t a, vec_t b) { return _mm256_add_epi16(a, b); }
+SIMD_TARGET inline vec_t vecSub16(vec_t a, vec_t b) { return _mm256_sub_epi16(a, b); }
+SIMD_TARGET inline vec_t vecMax16(vec_t a, vec_t b) { return _mm256_max_epi16(a, b); }
+SIMD_TARGET inline vec_t vecZero() { return _mm256_setzero_si256(); }
+SIMD_TARGET inline vec_t vecDotAdd(vec_t sum, vec_t a, vec_t b) {
+    return _mm256_add_epi32(sum, _mm256_madd_epi16(a, b));
+}
+SIMD_TARGET inline int32_t vecHsum32(vec_t v) {
+    __m128i r = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0x4E));
+    r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0xB1));
+    return _mm_cvtsi128_si32(r);
+}
+
+#include "nnue_kernels.h"
+}  // namespace avx2
+
+namespace avx512 {
+#define SIMD_TARGET __attribute__((target("avx2,avx512f,avx512bw")))
+#define SIMD_NAME "avx512bw"
+
+using vec_t = __m512i;
+constexpr int LANES = 32;
+
+SIMD_TARGET inline vec_t vecLoad(const int16_t *p) { return _mm512_loadu_si512(p); }
+SIMD_TARGET inline void vecStore(int16_t *p, vec_t v) { _mm512_storeu_si512(p, v); }
+SIMD_TARGET inline vec_t vecAdd16(vec_t a, vec_t b) { return _mm512_add_epi16(a, b); }
+SIMD_TARGET inline vec_t vecSub16(vec_t a, vec_t b) { return _mm512_sub_epi16(a, b); }
+SIMD_TARGET inline vec_t vecMax16(vec_t a, vec_t b) { return _mm512_max_epi16(a, b); }
+SIMD_TARGET inline vec_t vecZero() { return _mm512_setzero_si512(); }
+SIMD_TARGET inline vec_t vecDotAdd(vec_t sum, vec_t a, vec_t b) {
+    return _mm512_add_epi32(sum, _mm512_madd_epi16(a, b));
+}
+SIMD_TARGET inline int32_t vecHsum32(vec_t v) {
+    // the zero masked extracts avoid undefined upper halves, which gcc warns about with lto
+    const __m256i h = _mm256_add_epi32(_mm512_maskz_extracti64x4_epi64(0xF, v, 0),
+                                       _mm512_maskz_extracti64x4_epi64(0xF, v, 1));
+    __m128i r = _mm_add_epi32(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+    r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0x4E));
+    r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0xB1));
+    return _mm_cvtsi128_si32(r);
+}
+
+#include "nnue_kernels.h"
+}  // namespace avx512
+
+// Same as avx512bw but the multiply add is fused into a single vpdpwssd.
+namespace vnni512 {
+#define SIMD_TARGET __attribute__((target("avx2,avx512f,avx512bw,avx512vnni")))
+#define SIMD_NAME "avx512vnni"
+
+using vec_t = __m512i;
+constexpr int LANES = 32;
+
+SIMD_TARGET inline vec_t vecLoad(const int16_t *p) { return _mm512_loadu_si512(p); }
+SIMD_TARGET inline void vecStore(int16_t *p, vec_t v) { _mm512_storeu_si512(p, v); }
+SIMD_TARGET inline vec_t vecAdd16(vec_t a, vec_t b) { return _mm512_add_epi16(a, b); }
+SIMD_TARGET inline vec_t vecSub16(vec_t a, vec_t b) { return _mm512_sub_epi16(a, b); }
+SIMD_TARGET inline vec_t vecMax16(vec_t a, vec_t b) { return _mm512_max_epi16(a, b); }
+SIMD_TARGET inline vec_t vecZero() { return _mm512_setzero_si512(); }
+SIMD_TARGET inline vec_t vecDotAdd(vec_t sum, vec_t a, vec_t b) {
+    return _mm512_dpwssd_epi32(sum, a, b);
+}
+SIMD_TARGET inline int32_t vecHsum32(vec_t v) {
+    // the zero masked extracts avoid undefined upper halves, which gcc warns about with lto
+    const __m256i h = _mm256_add_epi32(_mm512_maskz_extracti64x4_epi64(0xF, v, 0),
+                                       _mm512_maskz_extracti64x4_epi64(0xF, v, 1));
+    __m128i r = _mm_add_epi32(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+    r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0x4E));
+    r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0xB1));
+    return _mm_cvtsi128_si32(r);
+}
+
+#include "nnue_kernels.h"
+}  // namespace vnni512
+
+static const Kernels &select() {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw"))
+        return vnni512::KERNELS;
+    if (__builtin_cpu_supports("avx512bw")) return avx512::KERNELS;
+    if (__builtin_cpu_supports("avx2")) return avx2::KERNELS;
+    if (__builtin_cpu_supports("sse2")) return sse2::KERNELS;
+
+    return scalar::KERNELS;
+}
+
+#elif defined(USE_NEON)
+
+/********************
+ * NEON is part of every aarch64 cpu, no runtime check needed.
+ *******************/
+namespace neon {
+#define SIMD_TARGET
+#define SIMD_NAME "neon"
+
+using vec_t = int16x8_t;
+constexpr int LANES = 8;
+
+inline vec_t vecLoad(const int16_t *p) { return vld1q_s16(p); }
+inline void vecStore(int16_t *p, vec_t v) { vst1q_s16(p, v); }
+inline vec_t vecAdd16(vec_t a, vec_t b) { return vaddq_s16(a, b); }
+inline vec_t vecSub16(vec_t a, vec_t b) { return vsubq_s16(a, b); }
+inline vec_t vecMax16(vec_t a, vec_t b) { return vmaxq_s16(a, b); }
+inline vec_t vecZero() { return vdupq_n_s16(0); }
+
+// the int32 sums are kept in the int16 vector type to share the kernel code
+inline vec_t vecDotAdd(vec_t sum, vec_t a, vec_t b) {
+    int32x4_t s = vreinterpretq_s32_s16(sum);
+    s = vmlal_s16(s, vget_low_s16(a), vget_low_s16(b));
+    s = vmlal_s16(s, vget_high_s16(a), vget_high_s16(b));
+    return vreinterpretq_s16_s32(s);
+}
+inline int32_t vecHsum32(vec_t v) {
+    const int32x4_t s = vreinterpretq_s32_s16(v);
+    return vgetq_lane_s32(s, 0) + vgetq_lane_s32(s, 1) + vgetq_lane_s32(s, 2) +
+           vgetq_lane_s32(s, 3);
+}
+
+#include "nnue_kernels.h"
+}  // namespace neon
+
+static const Kernels &select() { return neon::KERNELS; }
+
+#else
+
+static const Kernels &select() { return scalar::KERNELS; }
+
+#endif
+
+const Kernels &kernels = select();
+
+}  // namespace nnue::simd
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+#include "nnue.h"
+
+namespace nnue::simd {
+
+// Vectorized kernels, each one works on a single N_HIDDEN_SIZE wide
+// perspective of an accumulator.
+struct Kernels {
+    // name of the instruction set, printed when the network is loaded
+    const char *name;
+
+    // acc += weights
+    void (*add)(int16_t *acc, const int16_t *weights);
+
+    // acc -= weights
+    void (*sub)(int16_t *acc, const int16_t *weights);
+
+    // acc += add_weights - sub_weights
+    void (*addSub)(int16_t *acc, const int16_t *add_weights, const int16_t *sub_weights);
+
+    // dst = src + sum(adds) - sum(subs), every lane is read and written once,
+    // dst may be equal to src
+    void (*update)(int16_t *dst, const int16_t *src, const int16_t *const *adds, int add_count,
+                   const int16_t *const *subs, int sub_count);
+
+    // sum of relu(us) * weights[0..N) + relu(them) * weights[N..2N)
+    int32_t (*output)(const int16_t *us, const int16_t *them, const int16_t *weights);
+};
+
+// The widest kernels the host cpu supports, selected once at startup.
+extern const Kernels &kernels;
+
+}  // namespace nnue::simd
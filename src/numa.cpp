@@ -0,0 +1,134 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace numa {
+
+namespace {
+
+// parses a sysfs list like "0-3,8,10-11"
+std::vector<int> parseList(const std::string &list) {
+    std::vector<int> values;
+    std::stringstream ss(list);
+    std::string range;
+
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) continue;
+
+        const auto dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+        for (int i = first; i <= last; i++) values.push_back(i);
+    }
+
+    return values;
+}
+
+std::string readLine(const std::string &path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// compresses sorted cpus back into the sysfs list format
+std::string formatList(const std::vector<int> &values) {
+    std::stringstream ss;
+
+    for (std::size_t i = 0; i < values.size(); i++) {
+        std::size_t j = i;
+        while (j + 1 < values.size() && values[j + 1] == values[j] + 1) j++;
+
+        if (i != 0) ss << ",";
+        ss << values[i];
+        if (j != i) ss << "-" << values[j];
+
+        i = j;
+    }
+
+    return ss.str();
+}
+
+std::vector<std::vector<int>> detect() {
+    std::vector<int> usable;
+
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) usable.push_back(cpu);
+        }
+    }
+#endif
+
+    if (usable.empty()) {
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+            usable.push_back(cpu);
+    }
+
+    std::vector<std::vector<int>> topology;
+
+    const std::string base = "/sys/devices/system/node/";
+
+    for (const int node : parseList(readLine(base + "online"))) {
+        std::vector<int> cpus;
+
+        // cpus outside of our affinity mask, e.g. in a container, are left out
+        for (const int cpu : parseList(readLine(base + "node" + std::to_string(node) + "/cpulist")))
+            if (std::find(usable.begin(), usable.end(), cpu) != usable.end()) cpus.push_back(cpu);
+
+        // memory only nodes have no cpus
+        if (!cpus.empty()) topology.push_back(cpus);
+    }
+
+    if (topology.empty()) topology.push_back(usable);
+
+    return topology;
+}
+
+}  // namespace
+
+const std::vector<std::vector<int>> &nodes() {
+    static const std::vector<std::vector<int>> topology = detect();
+    return topology;
+}
+
+int nodeOf(int thread_id) { return thread_id % static_cast<int>(nodes().size()); }
+
+bool bindThisThread(int node) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (const int cpu : nodes()[node]) CPU_SET(cpu, &set);
+
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+std::string describe() {
+    std::stringstream ss;
+
+    ss << nodes().size() << (nodes().size() == 1 ? " node" : " nodes");
+
+    for (std::size_t i = 0; i < nodes().size(); i++) {
+        ss << ", node " << i << ": cpus " << formatList(nodes()[i]);
+    }
+
+    return ss.str();
+}
+
+}  // namespace numa
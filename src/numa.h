@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace numa {
+
+/// @brief the cpus of every NUMA node this process may run on, read once from sysfs.
+/// A single node with all usable cpus if the topology is unknown.
+[[nodiscard]] const std::vector<std::vector<int>> &nodes();
+
+/// @brief node of the thread with this id, threads are spread evenly over the nodes
+[[nodiscard]] int nodeOf(int thread_id);
+
+/// @brief restricts the calling thread to the cpus of node. Memory the thread touches
+/// first is then placed on that node by the kernel's default local allocation.
+/// @return false if the affinity couldn't be set
+bool bindThisThread(int node);
+
+/// @brief human readable topology, e.g. "2 nodes, node 0: cpus 0-31, node 1: cpus 32-63"
+[[nodiscard]] std::string describe();
+
+}  // namespace numa
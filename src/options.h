@@ -1,9 +1,11 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <iostream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "types.h"
 
@@ -18,12 +20,15 @@ namespace uci {
         std::string default_value;
         std::string min;
         std::string max;
+        // called by setoption once the value changed
+        std::function<void(const Option &)> on_change = nullptr;
     };
 
     class Options {
     public:
         void print() const {
-            for (const auto &[name, option]: options_) {
+            for (const auto &name: order_) {
+                const Option &option = options_.at(name);
                 std::cout << "option name " << name << " type " << option.type << " default "
                           << option.default_value;
                 if (!option.min.empty()) {
@@ -33,7 +38,19 @@ namespace uci {
             }
         }
 
-        void add(const Option &option) { options_[option.name] = option; }
+        void add(const Option &option) {
+            if (options_.find(option.name) == options_.end()) order_.push_back(option.name);
+            options_[option.name] = option;
+        }
+
+        // runs all change handlers with the current values in registration order,
+        // used once at startup
+        void applyAll() const {
+            for (const auto &name: order_) {
+                const Option &option = options_.at(name);
+                if (option.on_change) option.on_change(option);
+            }
+        }
 
         void set(const std::string &line) {
             std::vector<std::string> tokens = str_util::splitString(line, ' ');
@@ -77,6 +94,8 @@ namespace uci {
                 return;
             }
 
+            const std::string previous = options_[name].value;
+
             if (options_[name].type == "check") {
                 if (value == "true" || value == "false") {
                     options_[name].value = value;
@@ -85,8 +104,8 @@ namespace uci {
                     std::exit(1);
                 }
             } else if (options_[name].type == "spin") {
-                int32_t val = std::stoi(value);
-                if (val >= std::stoi(options_[name].min) && val <= std::stoi(options_[name].max)) {
+                int64_t val = std::stoll(value);
+                if (val >= std::stoll(options_[name].min) && val <= std::stoll(options_[name].max)) {
                     options_[name].value = value;
                 } else {
                     std::cout << ("Invalid value for option " + name + ": " + value);
@@ -95,8 +114,15 @@ namespace uci {
             } else if (options_[name].type == "string") {
                 options_[name].value = value;
             }
+
+            // GUIs resend all options, only apply what actually changed
+            if (options_[name].value != previous && options_[name].on_change)
+                options_[name].on_change(options_[name]);
         }
 
         std::unordered_map<std::string, Option> options_;
+
+        // option names in the order they were added
+        std::vector<std::string> order_;
     };
 }  // namespace uci
\ No newline at end of file
@@ -16,6 +16,17 @@ extern ThreadPool Threads;
 // Initialize reduction table
 int reductions[MAX_PLY][MAX_MOVES];
 
+// Helper threads skip some depths of the iterative deepening, each in its own pattern,
+// so at any time they search other depths than the main thread and each other.
+// The patterns are sorted by size, the ones up to size s are the first s * (s + 1).
+constexpr int SKIP_SIZE[] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+constexpr int SKIP_PHASE[] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+static bool skipDepth(int id, int depth, int max_size) {
+    const int i = (id - 1) % (max_size * (max_size + 1));
+    return ((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2;
+}
+
 void init_reductions() {
     reductions[0][0] = 0;
 
@@ -76,26 +87,34 @@ Score Search::qsearch(Score alpha, Score beta, Stack *ss) {
     Move ttmove = NO_MOVE;
     bool tt_hit = false;
 
-    const TEntry *tte = TTable.probe(tt_hit, ttmove, board.hash());
-    const Score tt_score = tt_hit ? scoreFromTT(tte->score, ss->ply) : Score(VALUE_NONE);
+    const TEntry tte = TTable.probe(tt_hit, ttmove, board.hash());
+    const Score tt_score = tt_hit ? scoreFromTT(tte.score, ss->ply) : Score(VALUE_NONE);
 
     // clang-format off
     if (tt_hit
         && !pv_node
         && tt_score != VALUE_NONE
-        && tte->flag != NONEBOUND) {
+        && tte.flag() != NONEBOUND) {
         // clang-format on
-        if (tte->flag == EXACTBOUND)
+        if (tte.flag() == EXACTBOUND)
             return tt_score;
-        else if (tte->flag == LOWERBOUND && tt_score >= beta)
+        else if (tte.flag() == LOWERBOUND && tt_score >= beta)
             return tt_score;
-        else if (tte->flag == UPPERBOUND && tt_score <= alpha)
+        else if (tte.flag() == UPPERBOUND && tt_score <= alpha)
             return tt_score;
     }
 
-    Score best_value = eval::evaluate(board);
+    // reuse the static evaluation of a transposition
+    const Score static_eval = tte.eval != VALUE_NONE ? tte.eval : eval::evaluate(board);
+    Score best_value = static_eval;
+
+    if (best_value >= beta) {
+        if (tte.eval == VALUE_NONE)
+            TTable.store(0, VALUE_NONE, NONEBOUND, board.hash(), NO_MOVE, static_eval);
+
+        return best_value;
+    }
 
-    if (best_value >= beta) return best_value;
     if (best_value > alpha) alpha = best_value;
 
     Movelist moves;
@@ -156,7 +175,8 @@ Score Search::qsearch(Score alpha, Score beta, Stack *ss) {
     const Flag bound = best_value >= beta ? LOWERBOUND : UPPERBOUND;
 
     if (!Threads.stop.load(std::memory_order_relaxed))
-        TTable.store(0, scoreToTT(best_value, ss->ply), bound, board.hash(), bestmove);
+        TTable.store(0, scoreToTT(best_value, ss->ply), bound, board.hash(), bestmove,
+                     static_eval);
 
     assert(best_value > -VALUE_INFINITE && best_value < VALUE_INFINITE);
     return best_value;
@@ -222,8 +242,8 @@ Score Search::absearch(int depth, Score alpha, Score beta, Stack *ss) {
     Move ttmove = NO_MOVE;
     bool tt_hit = false;
 
-    const TEntry *tte = TTable.probe(tt_hit, ttmove, board.hash());
-    const Score tt_score = tt_hit ? scoreFromTT(tte->score, ss->ply) : Score(VALUE_NONE);
+    const TEntry tte = TTable.probe(tt_hit, ttmove, board.hash());
+    const Score tt_score = tt_hit ? scoreFromTT(tte.score, ss->ply) : Score(VALUE_NONE);
 
     const Move excluded_move = ss->excluded_move;
 
@@ -237,14 +257,14 @@ Score Search::absearch(int depth, Score alpha, Score beta, Stack *ss) {
         && !pv_node
         && tt_hit
         && tt_score != VALUE_NONE
-        && tte->depth >= depth
+        && tte.depth >= depth
         && (ss - 1)->currentmove != NULL_MOVE) {
         // clang-format on
-        if (tte->flag == EXACTBOUND)
+        if (tte.flag() == EXACTBOUND)
             return tt_score;
-        else if (tte->flag == LOWERBOUND)
+        else if (tte.flag() == LOWERBOUND)
             alpha = std::max(alpha, tt_score);
-        else if (tte->flag == UPPERBOUND)
+        else if (tte.flag() == UPPERBOUND)
             beta = std::min(beta, tt_score);
         if (alpha >= beta) return tt_score;
     }
@@ -280,7 +300,8 @@ Score Search::absearch(int depth, Score alpha, Score beta, Stack *ss) {
 
         if (flag == EXACTBOUND || (flag == LOWERBOUND && tb_res >= beta) ||
             (flag == UPPERBOUND && tb_res <= alpha)) {
-            TTable.store(depth + 6, scoreToTT(tb_res, ss->ply), flag, board.hash(), NO_MOVE);
+            TTable.store(depth + 6, scoreToTT(tb_res, ss->ply), flag, board.hash(), NO_MOVE,
+                         VALUE_NONE);
             return tb_res;
         }
 
@@ -295,15 +316,24 @@ Score Search::absearch(int depth, Score alpha, Score beta, Stack *ss) {
     }
 
     bool improving = false;
+    Score static_eval = VALUE_NONE;
 
     if (in_check) {
         ss->eval = VALUE_NONE;
         goto moves;
     }
 
+    // The static evaluation of a transposition is reused, a new one is stored right away.
+    if (tte.eval != VALUE_NONE) {
+        static_eval = tte.eval;
+    } else if (!tt_hit) {
+        static_eval = eval::evaluate(board);
+        TTable.store(0, VALUE_NONE, NONEBOUND, board.hash(), NO_MOVE, static_eval);
+    }
+
     // Use the tt_score as a better evaluation of the position, other engines
     // typically have eval and staticEval. In Smallbrain its just eval.
-    ss->eval = tt_hit ? tt_score : eval::evaluate(board);
+    ss->eval = tt_hit ? tt_score : static_eval;
 
     // improving boolean
     improving = (ss - 2)->eval != VALUE_NONE && ss->eval > (ss - 2)->eval;
@@ -371,9 +401,14 @@ moves:
     uint8_t made_moves = 0;
     bool do_full_search = false;
 
-    MovePicker<ABSEARCH> mp(*this, ss, moves, searchmoves, root_node, tt_hit ? ttmove : NO_MOVE);
+    MovePicker<ABSEARCH> mp(*this, ss, moves, root_searchmoves_, root_node,
+                            tt_hit ? ttmove : NO_MOVE);
     ss->move_count = mp.movelist.size;
 
+    // with several threads, moves in progress elsewhere are searched last
+    const bool defer_moves = !root_node && !excluded_move && depth >= SearchingMoves::MIN_DEPTH &&
+                             Threads.size() > 1;
+
     /********************
      * Movepicker fetches the next move that we should search.
      * It is very important to return the likely best move first,
@@ -382,6 +417,12 @@ moves:
     while ((move = mp.nextMove()) != NO_MOVE) {
         if (move == excluded_move) continue;
 
+        const U64 searching_key = defer_moves ? SearchingMoves::key(board.hash(), move) : 0;
+
+        if (defer_moves && made_moves && Threads.searching.isSearched(searching_key) &&
+            mp.defer(move))
+            continue;
+
         made_moves++;
 
         int extension = 0;
@@ -423,8 +464,8 @@ moves:
             && ttmove == move
             && !excluded_move
             && std::abs(tt_score) < 10000
-            && tte->flag & LOWERBOUND
-            && tte->depth >= depth - 3) {
+            && tte.flag() & LOWERBOUND
+            && tte.depth >= depth - 3) {
             // clang-format on
             const Score singular_beta = tt_score - 3 * depth;
             const int singular_depth = (depth - 1) / 2;
@@ -463,6 +504,9 @@ moves:
          * Play the move on the internal board.
          *******************/
         nodes++;
+
+        const bool marked = defer_moves && Threads.searching.mark(searching_key);
+
         board.makeMove<true>(move);
 
         const U64 node_count = nodes;
@@ -514,12 +558,23 @@ moves:
 
         board.unmakeMove<false>(move);
 
+        if (marked) Threads.searching.unmark(searching_key);
+
         assert(score > -VALUE_INFINITE && score < VALUE_INFINITE);
 
         /********************
-         * Node count logic used for time control.
+         * Root moves keep their nodes for time control and their
+         * score for the MultiPV order. Only the best move of a line
+         * has an exact score, the others are sorted behind it.
          *******************/
-        if (id == 0) node_effort[from(move)][to(move)] += nodes - node_count;
+        RootMove *root_move = nullptr;
+
+        if (root_node) {
+            root_move = &*std::find(root_moves_.begin(), root_moves_.end(), move);
+            assert(root_move != &*root_moves_.end());
+            root_move->nodes += nodes - node_count;
+            root_move->score = made_moves == 1 || score > alpha ? score : -VALUE_INFINITE;
+        }
 
         /********************
          * Score beat best -> update PV and Bestmove.
@@ -543,6 +598,11 @@ moves:
 
                 pv_length_[ss->ply] = pv_length_[ss->ply + 1];
 
+                if (root_node) {
+                    const Move *pv = &pv_table_[0][0];
+                    root_move->pv.assign(pv, pv + pv_length_[0]);
+                }
+
                 /********************
                  * Score beat beta -> update histories and break.
                  *******************/
@@ -574,8 +634,10 @@ moves:
     const Flag b =
         best >= beta ? LOWERBOUND : (pv_node && bestmove != NO_MOVE ? EXACTBOUND : UPPERBOUND);
 
-    if (!excluded_move && !Threads.stop.load(std::memory_order_relaxed))
-        TTable.store(depth, scoreToTT(best, ss->ply), b, board.hash(), bestmove);
+    // Later MultiPV lines exclude the best move, so only the first line stores the root.
+    if (!excluded_move && !(root_node && pv_index_ > 0) &&
+        !Threads.stop.load(std::memory_order_relaxed))
+        TTable.store(depth, scoreToTT(best, ss->ply), b, board.hash(), bestmove, static_eval);
 
     assert(best > -VALUE_INFINITE && best < VALUE_INFINITE);
     return best;
@@ -593,7 +655,7 @@ Score Search::aspirationSearch(int depth, Score prev_eval, Stack *ss) {
      * few depths because these have quite unstable evaluation which
      * would lead to many researches.
      *******************/
-    if (depth >= 9) {
+    if (depth >= 9 && prev_eval != -VALUE_INFINITE) {
         alpha = prev_eval - delta;
         beta = prev_eval + delta;
     }
@@ -625,9 +687,13 @@ Score Search::aspirationSearch(int depth, Score prev_eval, Stack *ss) {
         }
     }
 
+    // the line's move and the moves after it are ordered by their new scores
+    std::stable_sort(root_moves_.begin() + pv_index_, root_moves_.end());
+
     if (id == 0 && !silent) {
         uci::output(result, board.ply(), depth, seldepth_, Threads.getNodes(), Threads.getTbHits(),
-                    getTime(), getPV(), TTable.hashfull());
+                    getTime(), getPV(pv_index_), TTable.hashfull(),
+                    Threads.multipv > 1 ? pv_index_ + 1 : 0);
     }
 
     return result;
@@ -656,9 +722,33 @@ SearchResult Search::iterativeDeepening() {
 
     pv_table_.reset();
     pv_length_.reset();
-    node_effort.reset();
 
-    auto lastPv = getPV();
+    last_result = SearchResult();
+
+    root_moves_.clear();
+
+    if (searchmoves.size > 0) {
+        for (const auto &ext : searchmoves) root_moves_.emplace_back(ext.move);
+    } else {
+        Movelist legal_moves;
+        movegen::legalmoves<Movetype::ALL>(board, legal_moves);
+
+        for (const auto &ext : legal_moves) root_moves_.emplace_back(ext.move);
+    }
+
+    // the first iteration has no scores yet, it starts with the move of the transposition table
+    bool tt_hit = false;
+    Move ttmove = NO_MOVE;
+    static_cast<void>(TTable.probe(tt_hit, ttmove, board.hash()));
+    const auto tt_root = std::find(root_moves_.begin(), root_moves_.end(), ttmove);
+
+    if (tt_hit && tt_root != root_moves_.end())
+        std::rotate(root_moves_.begin(), tt_root, tt_root + 1);
+
+    // a mated or stalemated root still searches one line
+    const int multipv = std::clamp<int>(Threads.multipv, 1, std::max<int>(root_moves_.size(), 1));
+
+    auto lastPv = getPV(0);
 
     /********************
      * Iterative Deepening Loop.
@@ -668,33 +758,60 @@ SearchResult Search::iterativeDeepening() {
 
     int depth = 1;
     for (; depth <= limit.depth; depth++) {
+        if (id != 0 && Threads.helper_skip_size > 0 &&
+            skipDepth(id, depth, Threads.helper_skip_size))
+            continue;
+
         seldepth_ = 0;
 
         const auto previousResult = search_result.score;
-        const auto value = aspirationSearch(depth, search_result.score, ss);
+
+        for (auto &root_move : root_moves_) root_move.previous_score = root_move.score;
+
+        Score value = 0;
+
+        for (pv_index_ = 0; pv_index_ < multipv; pv_index_++) {
+            // a line excludes the moves of the lines before it and searches
+            // the others best first, as sorted by the previous iterations
+            root_searchmoves_.size = 0;
+
+            for (std::size_t i = pv_index_; i < root_moves_.size(); i++)
+                root_searchmoves_.add(root_moves_[i].move);
+
+            const auto prev_eval =
+                pv_index_ == 0 ? search_result.score : root_moves_[pv_index_].previous_score;
+            const auto line_value = aspirationSearch(depth, prev_eval, ss);
+
+            if (pv_index_ == 0) value = line_value;
+
+            if (limitReached()) break;
+        }
 
         if (limitReached()) break;
 
-        // only mainthread manages time control
-        if (id != 0) continue;
+        // a mated or stalemated root has no moves
+        const RootMove best_root = root_moves_.empty() ? RootMove(NO_MOVE) : root_moves_[0];
 
-        if (search_result.bestmove != pv_table_[0][0]) bestmove_changes++;
+        if (search_result.bestmove != best_root.move) bestmove_changes++;
 
-        search_result.bestmove = pv_table_[0][0];
+        search_result.bestmove = best_root.move;
         search_result.score = value;
+        search_result.ponder = best_root.pv.size() > 1 ? best_root.pv[1] : NO_MOVE;
+        search_result.depth = depth;
 
-        lastPv = getPV();
+        lastPv = getPV(0);
+
+        // only mainthread manages time control
+        if (id != 0) continue;
 
         eval_average += search_result.score;
 
-        // limit type time
-        if (limit.time.optimum != 0) {
+        // limit type time, while pondering the GUI doesn't run our clock
+        if (limit.time.optimum != 0 && !Threads.ponder.load(std::memory_order_relaxed)) {
             auto now = getTime();
 
             // node count time management (https://github.com/Luecx/Koivisto 's idea)
-            int effort =
-                (node_effort[from(search_result.bestmove)][to(search_result.bestmove)] * 100) /
-                nodes;
+            int effort = (best_root.nodes * 100) / nodes;
             if (depth > 10 && limit.time.optimum * (110 - std::min(effort, 90)) / 100 < now) break;
 
             // increase optimum time if score is increasing
@@ -714,29 +831,46 @@ SearchResult Search::iterativeDeepening() {
 
     /********************
      * Dont stop analysis in infinite mode when max depth is reached
-     * wait for uci stop or quit
+     * wait for uci stop or quit. While pondering the bestmove
+     * may only be sent after ponderhit or stop.
      *******************/
-    while (limit.infinite && !Threads.stop.load(std::memory_order_relaxed)) {
-    }
+    if (limit.infinite || Threads.ponder.load(std::memory_order_relaxed))
+        Threads.waitForStop(limit.infinite);
 
     /********************
      * In case the depth was 1 make sure we have at least a bestmove.
      *******************/
-    if (depth == 1) search_result.bestmove = pv_table_[0][0];
+    if (depth == 1) {
+        search_result.bestmove = pv_table_[0][0];
+        search_result.depth = 1;
+    }
+
+    search_result.pv =
+        lastPv.empty() ? " " + uci::moveToUci(search_result.bestmove, board.chess960) : lastPv;
+
+    last_result = search_result;
 
     /********************
      * Mainthread prints bestmove.
+     * The helpers finish first and all threads vote on the move.
+     * With MultiPV the main thread's first line is reported, a voted
+     * move could differ from it.
      * Allowprint is disabled in data generation
      *******************/
     if (id == 0 && !silent) {
-        uci::output(
-            search_result.score, board.ply(), depth, seldepth_, Threads.getNodes(),
-            Threads.getTbHits(), getTime(),
-            lastPv.empty() ? uci::moveToUci(search_result.bestmove, board.chess960) : lastPv,
-            TTable.hashfull());
-        std::cout << "bestmove " << uci::moveToUci(search_result.bestmove, board.chess960)
-                  << std::endl;
-        Threads.stop = true;
+        Threads.stopSearch();
+
+        const SearchResult &best = Threads.multipv > 1 ? last_result : Threads.vote(*this);
+
+        uci::output(best.score, board.ply(), best.depth, seldepth_, Threads.getNodes(),
+                    Threads.getTbHits(), getTime(), best.pv, TTable.hashfull(),
+                    Threads.multipv > 1 ? 1 : 0);
+        std::cout << "bestmove " << uci::moveToUci(best.bestmove, board.chess960);
+
+        if (best.ponder != NO_MOVE)
+            std::cout << " ponder " << uci::moveToUci(best.ponder, board.chess960);
+
+        std::cout << std::endl;
     }
 
     printMean();
@@ -745,14 +879,16 @@ SearchResult Search::iterativeDeepening() {
 }
 
 void Search::reset() {
-    nodes = 0;
-    tbhits = 0;
-
-    node_effort.reset();
+    prepareSearch();
 
     history.reset();
     counters.reset();
     consthist.reset();
+}
+
+void Search::prepareSearch() {
+    nodes = 0;
+    tbhits = 0;
 
     killers.reset();
 }
@@ -768,13 +904,14 @@ void Search::startThinking() {
     /********************
      * Play dtz move when time is limited
      *******************/
-    if (id == 0 && limit.time.optimum != 0 && use_tb) {
+    if (id == 0 && limit.time.optimum != 0 && use_tb &&
+        !Threads.ponder.load(std::memory_order_relaxed)) {
         const auto dtz = syzygy::probeDTZ(board);
         if (dtz.second != NO_MOVE) {
             uci::output(dtz.first, 1, 1, 1, 1, 1, 0,
                         " " + uci::moveToUci(dtz.second, board.chess960), 0);
             std::cout << "bestmove " << uci::moveToUci(dtz.second, board.chess960) << std::endl;
-            Threads.stop = true;
+            Threads.stopSearch();
             return;
         }
     }
@@ -793,11 +930,11 @@ bool Search::limitReached() {
 
     check_time_ = 2047;
 
-    if (limit.time.maximum != 0) {
+    if (limit.time.maximum != 0 && !Threads.ponder.load(std::memory_order_relaxed)) {
         auto ms = getTime();
 
         if (ms >= limit.time.maximum) {
-            Threads.stop = true;
+            Threads.stopSearch();
 
             return true;
         }
@@ -805,11 +942,13 @@ bool Search::limitReached() {
     return false;
 }
 
-std::string Search::getPV() const {
+std::string Search::getPV(int pv_index) const {
     std::stringstream ss;
 
-    for (int i = 0; i < pv_length_[0]; i++) {
-        ss << " " << uci::moveToUci(pv_table_[0][i], board.chess960);
+    if (pv_index >= static_cast<int>(root_moves_.size())) return ss.str();
+
+    for (const Move move : root_moves_[pv_index].pv) {
+        ss << " " << uci::moveToUci(move, board.chess960);
     }
 
     return ss.str();
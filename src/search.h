@@ -1,6 +1,7 @@
 #pragma once
 
 #include <thread>
+#include <vector>
 
 #include "board.h"
 #include "movegen.h"
@@ -15,9 +16,32 @@ struct Stack {
     uint16_t ply;
 };
 
+// A move of the root with its results, kept across the iterations of a search.
+struct RootMove {
+    explicit RootMove(Move m) : move(m) {}
+
+    bool operator==(Move m) const { return move == m; }
+
+    // higher scores first, the order of equal ones is kept by a stable sort
+    bool operator<(const RootMove &other) const { return score > other.score; }
+
+    Move move;
+    // -VALUE_INFINITE if it wasn't the best move of its line in the last search
+    Score score = -VALUE_INFINITE;
+    Score previous_score = -VALUE_INFINITE;
+    // nodes spent on this move during the whole search, used for time control
+    U64 nodes = 0;
+    std::vector<Move> pv;
+};
+
 struct SearchResult {
     Move bestmove = NO_MOVE;
     Score score = -VALUE_INFINITE;
+    // reply expected by the pv, the GUI ponders on it
+    Move ponder = NO_MOVE;
+    // last completed depth and its pv
+    int depth = 0;
+    std::string pv;
 };
 
 class Search {
@@ -27,8 +51,12 @@ class Search {
     // data generation entry function
     SearchResult iterativeDeepening();
 
+    // resets everything, including the histories
     void reset();
 
+    // resets the data of the previous search, the histories are kept
+    void prepareSearch();
+
     Board board = Board();
 
     Table<int16_t, N_PIECES + 1, 64, N_PIECES + 1, 64> consthist;
@@ -39,9 +67,6 @@ class Search {
     // Counter moves for quiet move ordering
     Table<Move, MAX_SQ, MAX_SQ> counters = {};
 
-    // node count logic
-    Table<U64, MAX_SQ, MAX_SQ> node_effort = {};
-
     // Killer moves for quiet move ordering
     Table<Move, 2, MAX_PLY + 1> killers = {};
 
@@ -57,6 +82,9 @@ class Search {
     U64 nodes = 0;
     U64 tbhits = 0;
 
+    // result of the last completed iteration, all threads vote with it
+    SearchResult last_result = {};
+
     // thread id, Mainthread = 0
     int id = 0;
 
@@ -80,13 +108,24 @@ class Search {
     // check limits
     [[nodiscard]] bool limitReached();
 
-    [[nodiscard]] std::string getPV() const;
+    // the pv of a MultiPV line
+    [[nodiscard]] std::string getPV(int pv_index) const;
     [[nodiscard]] int64_t getTime() const;
 
     // pv collection
     Table<uint8_t, MAX_PLY + 1> pv_length_ = {};
     Table<Move, MAX_PLY + 1, MAX_PLY + 1> pv_table_ = {};
 
+    // all moves of the root, ordered by their score once searched
+    std::vector<RootMove> root_moves_;
+
+    // the MultiPV line being searched, lines before it are excluded at the root
+    int pv_index_ = 0;
+
+    // the root moves of the current line in the order of root_moves_, the root searches
+    // them in this order
+    Movelist root_searchmoves_ = {};
+
     // timepoint when we entered search
     TimePoint::time_point t0_;
 
@@ -26,7 +26,7 @@ inline bool testFenRepetition(const std::string &input) {
         }
     }
 
-    board.refreshNNUE(board.getAccumulator());
+    board.refreshNNUE();
 
     return board.isRepetition(2);
 }
@@ -0,0 +1,43 @@
+#pragma once
+#include "tests.h"
+
+namespace tests {
+
+// compares the lazily updated accumulator against a fresh one
+inline void expectAccumulator(Board &b, const std::string &input) {
+    Board fresh(b.getFen());
+    const bool equal = b.getAccumulator() == fresh.getAccumulator();
+    expect(equal, true, input);
+}
+
+inline void testNNUEWalk(const std::string &fen) {
+    Board b(fen);
+
+    for (int ply = 0; ply < 80; ply++) {
+        Movelist moves;
+        movegen::legalmoves<Movetype::ALL>(b, moves);
+        if (moves.size == 0) break;
+
+        // every move and its takeback
+        for (const auto &ext : moves) {
+            b.makeMove<true>(ext.move);
+            expectAccumulator(b, b.getFen());
+            b.unmakeMove<true>(ext.move);
+            expectAccumulator(b, b.getFen());
+        }
+
+        // several plies without evaluation in between
+        b.makeMove<true>(moves[(ply * 7 + 3) % moves.size].move);
+        if (ply % 3 == 2) expectAccumulator(b, b.getFen());
+    }
+}
+
+inline void testAllNNUE() {
+    testNNUEWalk(DEFAULT_POS);
+    testNNUEWalk("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    testNNUEWalk("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+    testNNUEWalk("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1");
+    testNNUEWalk("rnbqkb1r/pp1p1ppp/5n2/2pPp3/8/8/PPP1PPPP/RNBQKBNR w KQkq e6 0 4");
+}
+
+}  // namespace tests
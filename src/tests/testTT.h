@@ -0,0 +1,38 @@
+#pragma once
+
+#include "tests.h"
+#include "../tt.h"
+
+namespace tests {
+inline void testAllTT() {
+    const U64 key = 0x9d39247e33776d41ull;
+    bool tt_hit = false;
+    Move ttmove = NO_MOVE;
+
+    TTable.clear();
+
+    // an eval-only entry is no hit but keeps the static evaluation
+    TTable.store(0, VALUE_NONE, NONEBOUND, key, NO_MOVE, 42);
+    TEntry tte = TTable.probe(tt_hit, ttmove, key);
+    expect(tt_hit, false, "Eval-only entry");
+    expect(tte.eval, 42, "Eval-only entry");
+
+    // a searched entry keeps the stored evaluation
+    TTable.store(2, 100, LOWERBOUND, key, NO_MOVE, VALUE_NONE);
+    tte = TTable.probe(tt_hit, ttmove, key);
+    expect(tt_hit, true, "Searched entry");
+    expect(tte.score, 100, "Searched entry");
+    expect(tte.eval, 42, "Searched entry");
+
+    // an eval-only store doesn't overwrite the score, depth or bound
+    TTable.store(0, VALUE_NONE, NONEBOUND, key, NO_MOVE, 50);
+    tte = TTable.probe(tt_hit, ttmove, key);
+    expect(tt_hit, true, "Eval-only store on searched entry");
+    expect(tte.score, 100, "Eval-only store on searched entry");
+    expect(int(tte.depth), 2, "Eval-only store on searched entry");
+    expect(tte.flag(), LOWERBOUND, "Eval-only store on searched entry");
+    expect(tte.eval, 50, "Eval-only store on searched entry");
+
+    TTable.clear();
+}
+}  // namespace tests
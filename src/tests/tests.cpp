@@ -1,6 +1,8 @@
 #include "tests.h"
 #include "testDraw.h"
 #include "testFenRepetition.h"
+#include "testNNUE.h"
+#include "testTT.h"
 #include "testZobristHash.h"
 
 namespace tests {
@@ -13,6 +15,10 @@ bool testall() {
     testAllZobristHash();
     std::cout << "Running testAllDraw" << std::endl;
     testAllDraw();
+    std::cout << "Running testAllNNUE" << std::endl;
+    testAllNNUE();
+    std::cout << "Running testAllTT" << std::endl;
+    testAllTT();
 
     std::cout << "Tests run successfully" << std::endl;
     return true;
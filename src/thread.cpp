@@ -2,13 +2,70 @@
 
 #include "thread.h"
 
-void SearchInstance::start() const { search->startThinking(); }
+#include "numa.h"
+
+SearchInstance::SearchInstance(int id, int node) {
+    thread_ = std::thread(&SearchInstance::idleLoop, this, id, node);
+
+    // the thread is ready once it went to sleep
+    waitForSearchFinished();
+}
+
+SearchInstance::~SearchInstance() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exit_ = true;
+        searching_ = true;
+    }
+
+    cv_.notify_one();
+    thread_.join();
+}
+
+void SearchInstance::startSearching() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        searching_ = true;
+    }
+
+    cv_.notify_one();
+}
+
+void SearchInstance::waitForSearchFinished() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !searching_; });
+}
+
+void SearchInstance::idleLoop(int id, int node) {
+    if (node != -1) numa::bindThisThread(node);
+
+    // allocated and zeroed by this thread, the pages end up on its node
+    search = std::make_unique<Search>();
+    search->id = id;
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        searching_ = false;
+        cv_.notify_one();
+
+        cv_.wait(lock, [this] { return searching_; });
+
+        if (exit_) return;
+
+        lock.unlock();
+
+        search->startThinking();
+    }
+}
+
+ThreadPool::~ThreadPool() { kill(); }
 
 U64 ThreadPool::getNodes() const {
     U64 total = 0;
 
     for (auto &th : pool_) {
-        total += th.search->nodes;
+        total += th->search->nodes;
     }
 
     return total;
@@ -18,58 +75,133 @@ U64 ThreadPool::getTbHits() const {
     U64 total = 0;
 
     for (auto &th : pool_) {
-        total += th.search->tbhits;
+        total += th->search->tbhits;
     }
 
     return total;
 }
 
-void ThreadPool::start(const Board &board, const Limits &limit, const Movelist &searchmoves,
-                       int worker_count, bool use_tb) {
-    assert(running_threads_.size() == 0);
+void ThreadPool::resize(int worker_count) {
+    while (static_cast<int>(pool_.size()) > worker_count) pool_.pop_back();
+
+    while (static_cast<int>(pool_.size()) < worker_count) {
+        const int id = pool_.size();
+        const int node = numa_binding_ ? numa::nodeOf(id) : -1;
+
+        pool_.emplace_back(std::make_unique<SearchInstance>(id, node));
+    }
+}
 
+void ThreadPool::start(const Board &board, const Limits &limit, const Movelist &searchmoves,
+                       int worker_count, bool use_tb, bool keep_history) {
     stop = false;
+    ponder = limit.ponder;
 
-    SearchInstance mainThread;
+    TTable.newSearch();
 
-    if (!pool_.empty()) mainThread = pool_[0];
+    resize(worker_count);
 
+    // only the root is seeded, the threads keep their own data
+    for (auto &th : pool_) {
+        Search &search = *th->search;
+
+        if (keep_history) {
+            search.prepareSearch();
+        } else {
+            search.reset();
+        }
+
+        search.board.copyPosition(board);
+        search.limit = limit;
+        search.use_tb = use_tb;
+        search.searchmoves = searchmoves;
+    }
+
+    // the main thread last, it waits for the helpers at the end of its search
+    for (auto it = pool_.rbegin(); it != pool_.rend(); ++it) {
+        (*it)->startSearching();
+    }
+}
+
+void ThreadPool::clear() {
+    kill();
+
+    for (auto &th : pool_) {
+        th->search->reset();
+    }
+}
+
+void ThreadPool::setNumaBinding(bool bind) {
+    if (bind == numa_binding_) return;
+
+    kill();
+
+    numa_binding_ = bind;
     pool_.clear();
+}
 
-    // update with info
-    mainThread.search->id = 0;
-    mainThread.search->board = board;
-    mainThread.search->limit = limit;
-    mainThread.search->use_tb = use_tb;
-    mainThread.search->nodes = 0;
-    mainThread.search->tbhits = 0;
-    mainThread.search->node_effort.reset();
-    mainThread.search->searchmoves = searchmoves;
+void ThreadPool::stopSearch() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stop = true;
+    }
 
-    pool_.emplace_back(mainThread);
+    stop_cv_.notify_all();
+}
 
-    // start at index 1 to keep "mainthread" data alive
-    mainThread.search->consthist.reset();
-    mainThread.search->history.reset();
-    mainThread.search->counters.reset();
+void ThreadPool::ponderhit() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        ponder = false;
+    }
 
-    for (int i = 1; i < worker_count; i++) {
-        mainThread.search->id = i;
+    stop_cv_.notify_all();
+}
 
-        pool_.emplace_back(mainThread);
+void ThreadPool::waitForStop(bool infinite) {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stop_cv_.wait(lock, [this, infinite] { return stop || (!infinite && !ponder); });
+}
+
+const SearchResult &ThreadPool::vote(const Search &main) {
+    std::vector<const SearchResult *> results = {&main.last_result};
+
+    for (auto &th : pool_) {
+        if (th->search.get() == &main) continue;
+
+        th->waitForSearchFinished();
+
+        const SearchResult &result = th->search->last_result;
+        if (result.bestmove != NO_MOVE) results.push_back(&result);
     }
 
-    for (int i = 0; i < worker_count; i++) {
-        running_threads_.emplace_back(&SearchInstance::start, std::ref(pool_[i]));
+    int min_score = VALUE_INFINITE;
+    for (const auto *result : results) min_score = std::min<int>(min_score, result->score);
+
+    std::unordered_map<Move, int64_t> votes;
+    for (const auto *result : results) {
+        votes[result->bestmove] += int64_t(result->score - min_score + 14) * result->depth;
     }
+
+    const SearchResult *best = results[0];
+
+    for (const auto *result : results) {
+        // a found mate is preferred over the votes, the shortest one
+        if (best->score >= VALUE_MATE_IN_PLY) {
+            if (result->score > best->score) best = result;
+        } else if (result->score >= VALUE_MATE_IN_PLY ||
+                   votes[result->bestmove] > votes[best->bestmove]) {
+            best = result;
+        }
+    }
+
+    return *best;
 }
 
 void ThreadPool::kill() {
-    stop = true;
-
-    for (auto &th : running_threads_)
-        if (th.joinable()) th.join();
+    stopSearch();
 
-    pool_.clear();
-    running_threads_.clear();
+    for (auto &th : pool_) {
+        th->waitForSearchFinished();
+    }
 }
@@ -1,52 +1,117 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "abdada.h"
 #include "search.h"
 
-// A wrapper class to start the search
+// A search thread that lives as long as the pool. It sleeps on a condition variable
+// between searches and keeps its Search data, so a go doesn't create threads or copy data.
+// Each thread allocates its Search itself, the histories are only reset, never copied.
+// A thread bound to a NUMA node also first touches its Search there, so it is node local.
 class SearchInstance {
 public:
-    SearchInstance() { search = std::make_unique<Search>(); }
+    /// @param id
+    /// @param node NUMA node the thread is bound to, -1 for no binding
+    SearchInstance(int id, int node);
 
-    SearchInstance(const SearchInstance &other) {
-        search = std::make_unique<Search>(*other.search);
-    }
+    SearchInstance(const SearchInstance &other) = delete;
+    SearchInstance &operator=(const SearchInstance &other) = delete;
 
-    SearchInstance &operator=(const SearchInstance &other) {
-        // protect against invalid self-assignment
-        if (this != &other) {
-            search = std::make_unique<Search>(*other.search);
-        }
-        // by convention, always return *this
-        return *this;
-    }
+    // the thread has to be idle
+    ~SearchInstance();
 
-    ~SearchInstance() = default;
+    /// @brief wakes the thread up to search with the data set in search
+    void startSearching();
 
-    void start() const;
+    /// @brief blocks until the current search has finished
+    void waitForSearchFinished();
 
     std::unique_ptr<Search> search;
+
+private:
+    void idleLoop(int id, int node);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    bool searching_ = true;
+    bool exit_ = false;
+
+    // started last, idleLoop uses all other members
+    std::thread thread_;
 };
 
-// Holds all currently running threads and their data
+// Holds all search threads and their data
 class ThreadPool {
 public:
+    ~ThreadPool();
+
+    [[nodiscard]] std::size_t size() const { return pool_.size(); }
+
     [[nodiscard]] U64 getNodes() const;
 
     [[nodiscard]] U64 getTbHits() const;
 
+    /// @brief starts a search of board on worker_count threads
+    /// @param keep_history the histories of the previous search stay in use
     void start(const Board &board, const Limits &limit, const Movelist &searchmoves,
-               int worker_count, bool use_tb);
+               int worker_count, bool use_tb, bool keep_history);
+
+    /// @brief stops the search and resets the data of all threads, used for a new game
+    void clear();
+
+    /// @brief binds the search threads to the NUMA nodes round robin, the threads
+    /// are recreated so their data is allocated on their node
+    void setNumaBinding(bool bind);
 
+    /// @brief stops the search and waits until all threads are idle
     void kill();
 
+    /// @brief signals all threads to stop, wakes threads blocked in waitForStop
+    void stopSearch();
+
+    /// @brief the opponent played the expected move, the search continues with time limits
+    void ponderhit();
+
+    /// @brief blocks a finished search until it may report its result, which is
+    /// after stop in infinite mode or after ponderhit or stop while pondering
+    void waitForStop(bool infinite);
+
+    /// @brief waits for the helpers of main and picks the result of the search.
+    /// Every thread votes for its move, weighted by its depth and score.
+    [[nodiscard]] const SearchResult &vote(const Search &main);
+
     std::atomic_bool stop;
 
+    // searching on the opponent's time, time limits don't apply
+    std::atomic_bool ponder = false;
+
+    // largest skip size of the helpers' depth patterns, 0 searches all depths,
+    // only set between searches
+    int helper_skip_size = 4;
+
+    // number of best lines every thread searches
+    int multipv = 1;
+
+    // moves in progress, a thread defers moves other threads are searching
+    SearchingMoves searching;
+
 private:
-    std::vector<SearchInstance> pool_;
-    std::vector<std::thread> running_threads_;
-};
\ No newline at end of file
+    /// @brief creates or destroys threads, the others keep their data
+    void resize(int worker_count);
+
+    std::vector<std::unique_ptr<SearchInstance>> pool_;
+
+    bool numa_binding_ = false;
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+};
@@ -1,51 +1,237 @@
 #include "tt.h"
 
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "numa.h"
+
 TranspositionTable::TranspositionTable() { allocateMB(16); }
 
-void TranspositionTable::store(int depth, Score bestvalue, Flag b, U64 key, Move move) {
-    TEntry *tte = &entries_[index(key)];
+TranspositionTable::~TranspositionTable() { memory::freeLargePages(memory_); }
+
+// The entry with the same key, or else the one with the lowest depth minus age.
+void TranspositionTable::store(int depth, Score bestvalue, Flag b, U64 key, Move move,
+                               Score eval) {
+    TCluster &cluster = clusters_[index(key)];
+
+    TSlot *slot = &cluster.slots[0];
+    TEntry tte = slot->load();
+
+    for (TSlot &candidate : cluster.slots) {
+        const TEntry entry = candidate.load();
+
+        if (entry.key == key) {
+            slot = &candidate;
+            tte = entry;
+            break;
+        }
+
+        if (entry.depth - 8 * relativeAge(entry) < tte.depth - 8 * relativeAge(tte)) {
+            slot = &candidate;
+            tte = entry;
+        }
+    }
+
+    if (tte.key != key) tte.eval = VALUE_NONE;
+    if (eval != VALUE_NONE) tte.eval = eval;
+
+    // an eval-only store never downgrades the score, bound or move of the same position
+    if (tte.key == key && b == NONEBOUND) {
+        slot->store(tte);
+        return;
+    }
 
-    if (tte->key != key || move) tte->move = move;
+    if (tte.key != key || move) tte.move = move;
 
-    if (tte->key != key || b == EXACTBOUND || depth + 4 > tte->depth) {
-        tte->depth = depth;
-        tte->score = bestvalue;
-        tte->key = key;
-        tte->flag = b;
+    if (tte.key != key || b == EXACTBOUND || depth + 4 > tte.depth ||
+        tte.generation() != generation_) {
+        tte.depth = depth;
+        tte.score = bestvalue;
+        tte.key = key;
+        tte.gen_bound = generation_ | b;
     }
+
+    slot->store(tte);
 }
 
-const TEntry *TranspositionTable::probe(bool &tt_hit, Move &ttmove, U64 key) const {
-    const TEntry *tte = &entries_[index(key)];
-    tt_hit = (tte->key == key);
-    ttmove = tte->move;
-    return tte;
+TEntry TranspositionTable::probe(bool &tt_hit, Move &ttmove, U64 key) {
+    TCluster &cluster = clusters_[index(key)];
+
+    for (TSlot &slot : cluster.slots) {
+        TEntry entry = slot.load();
+
+        if (entry.key != key) continue;
+
+        // an entry without bound only holds the static evaluation
+        tt_hit = entry.flag() != NONEBOUND;
+        ttmove = tt_hit ? entry.move : NO_MOVE;
+
+        // keep the entry from aging
+        if (tt_hit && entry.generation() != generation_) {
+            entry.gen_bound = generation_ | entry.flag();
+            slot.store(entry);
+        }
+
+        return entry;
+    }
+
+    tt_hit = false;
+    ttmove = NO_MOVE;
+    return TEntry();
 }
 
-uint32_t TranspositionTable::index(U64 key) const {
+U64 TranspositionTable::index(U64 key) const {
 #ifdef __SIZEOF_INT128__
-    return (uint64_t)(((__uint128_t)key * (__uint128_t)entries_.size()) >> 64);
+    return (uint64_t)(((__uint128_t)key * (__uint128_t)cluster_count_) >> 64);
 #else
-    return key % entries_.size();
+    return key % cluster_count_;
 #endif
 }
 
-void TranspositionTable::allocate(U64 size) { entries_.resize(size, TEntry()); }
+void TranspositionTable::allocate(U64 size) {
+    if (size == cluster_count_) return;
+
+    memory::freeLargePages(memory_);
+    clusters_ = nullptr;
+    cluster_count_ = 0;
+
+    memory_ = memory::allocateLargePages(size * sizeof(TCluster));
+
+    if (memory_.ptr == nullptr) {
+        std::cout << "info string failed to allocate " << size * sizeof(TCluster)
+                  << " bytes for the hash" << std::endl;
+        exit(1);
+    }
+
+    clusters_ = static_cast<TCluster *>(memory_.ptr);
+    cluster_count_ = size;
+    clear();
+
+    std::cout << "info string hash uses " << memory::pageKindName(memory_.kind) << std::endl;
+}
 
 void TranspositionTable::allocateMB(U64 size_mb) {
     U64 sizeB = size_mb * static_cast<int>(1e6);
-    sizeB = std::clamp(sizeB, U64(1), U64(MAXHASH_MiB * 1e6));
-    U64 elements = sizeB / sizeof(TEntry);
+    sizeB = std::clamp(sizeB, U64(sizeof(TCluster)), U64(MAXHASH_MiB * 1e6));
+    U64 elements = sizeB / sizeof(TCluster);
     allocate(elements);
     std::cout << "hash set to " << sizeB / 1e6 << " MB" << std::endl;
 }
 
-void TranspositionTable::clear() { std::fill(entries_.begin(), entries_.end(), TEntry()); }
+void TranspositionTable::setThreads(int threads) {
+    threads = std::max(threads, 1);
+    if (threads == thread_count_) return;
+
+    thread_count_ = threads;
+
+    const U64 size = cluster_count_;
+    cluster_count_ = 0;
+    allocate(size);
+}
+
+void TranspositionTable::setNumaBinding(bool bind) {
+    if (bind == numa_binding_) return;
+
+    numa_binding_ = bind;
+
+    const U64 size = cluster_count_;
+    cluster_count_ = 0;
+    allocate(size);
+}
+
+void TranspositionTable::clear() {
+    const U64 chunk = (cluster_count_ + thread_count_ - 1) / thread_count_;
+
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < thread_count_; i++) {
+        const U64 begin = std::min<U64>(i * chunk, cluster_count_);
+        const U64 count = std::min<U64>(chunk, cluster_count_ - begin);
+
+        threads.emplace_back([this, i, begin, count]() {
+            if (numa_binding_) numa::bindThisThread(numa::nodeOf(i));
+
+            for (U64 j = begin; j < begin + count; j++) {
+                for (TSlot &slot : clusters_[j].slots) slot.store(TEntry());
+            }
+        });
+    }
+
+    for (auto &th : threads) th.join();
+
+    generation_ = 0;
+}
 
 int TranspositionTable::hashfull() const {
+    constexpr size_t samples = 1000 / TCluster::SIZE;
+
     int used = 0;
-    for (size_t i = 0; i < 1000; i++) {
-        used += entries_[i].flag != NONEBOUND;
+    for (size_t i = 0; i < std::min<U64>(samples, cluster_count_); i++) {
+        for (const TSlot &slot : clusters_[i].slots) {
+            const TEntry entry = slot.load();
+            used += entry.flag() != NONEBOUND && entry.generation() == generation_;
+        }
     }
     return used;
 }
+
+bool TranspositionTable::save(const std::string &filename) const {
+    TTFileHeader header = {};
+    std::memcpy(header.magic, TTFileHeader::MAGIC, sizeof(header.magic));
+    header.version = TTFileHeader::VERSION;
+    header.slot_size = sizeof(TSlot);
+    header.cluster_slots = TCluster::SIZE;
+    header.cluster_count = cluster_count_;
+    header.generation = generation_;
+
+    FILE *f = fopen(filename.c_str(), "wb");
+    if (f == nullptr) return false;
+
+    const bool written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                         fwrite(clusters_, sizeof(TCluster), cluster_count_, f) == cluster_count_;
+
+    return fclose(f) == 0 && written;
+}
+
+bool TranspositionTable::load(const std::string &filename) {
+    memory::Allocation file = memory::mapFile(filename.c_str());
+
+    if (file.ptr == nullptr) {
+        std::cout << "info string failed to open " << filename << std::endl;
+        return false;
+    }
+
+    TTFileHeader header = {};
+    if (file.size >= sizeof(header)) std::memcpy(&header, file.ptr, sizeof(header));
+
+    const char *error = nullptr;
+
+    if (std::memcmp(header.magic, TTFileHeader::MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TTFileHeader::VERSION) {
+        error = "is not a hash file of this version";
+    } else if (header.slot_size != sizeof(TSlot) || header.cluster_slots != TCluster::SIZE) {
+        error = "has a different entry format";
+    } else if (header.cluster_count != cluster_count_) {
+        error = "has a different size than the current Hash setting";
+    } else if (file.size != sizeof(header) + cluster_count_ * sizeof(TCluster)) {
+        error = "is truncated";
+    }
+
+    if (error) {
+        std::cout << "info string " << filename << " " << error << std::endl;
+        memory::freeLargePages(file);
+        return false;
+    }
+
+    memory::freeLargePages(memory_);
+    memory_ = file;
+
+    clusters_ = reinterpret_cast<TCluster *>(static_cast<char *>(memory_.ptr) + sizeof(header));
+    generation_ = header.generation;
+
+    std::cout << "info string hash uses " << memory::pageKindName(memory_.kind) << std::endl;
+    return true;
+}
@@ -1,26 +1,121 @@
 #pragma once
 
-#include <vector>
+#include <atomic>
+#include <string>
 
 #include "builtin.h"
 #include "helper.h"
+#include "memory.h"
 #include "types.h"
 
-
-PACK(struct TEntry {
+// A snapshot of an entry, the table stores it as two 64 bit words.
+struct TEntry {
     U64 key = 0;
     Score score = 0;
     Move move = NO_MOVE;
     uint8_t depth = 0;
-    Flag flag = NONEBOUND;
-});
+    // the bound in the lower 2 bits, the search generation in the upper 6 bits
+    uint8_t gen_bound = NONEBOUND;
+    // static evaluation of the position, VALUE_NONE if unknown
+    Score eval = VALUE_NONE;
+
+    [[nodiscard]] Flag flag() const { return Flag(gen_bound & 0x3); }
+    [[nodiscard]] uint8_t generation() const { return gen_bound & ~0x3; }
+
+    [[nodiscard]] U64 data() const {
+        return U64(static_cast<uint16_t>(score)) | U64(move) << 16 | U64(depth) << 32 |
+               U64(gen_bound) << 40 | U64(static_cast<uint16_t>(eval)) << 48;
+    }
+
+    [[nodiscard]] static TEntry fromData(U64 key, U64 data) {
+        TEntry entry;
+        entry.key = key;
+        entry.score = static_cast<Score>(data & 0xFFFF);
+        entry.move = Move((data >> 16) & 0xFFFF);
+        entry.depth = (data >> 32) & 0xFF;
+        entry.gen_bound = (data >> 40) & 0xFF;
+        entry.eval = static_cast<Score>((data >> 48) & 0xFFFF);
+        return entry;
+    }
+};
+
+// The key is stored xor'ed with the data. When two threads write the same slot at once,
+// the words of different writes don't decode to the key of either position, so a torn
+// entry is a miss instead of wrong data. No locks are needed.
+struct TSlot {
+    std::atomic<U64> key_xor_data;
+    std::atomic<U64> data;
+
+    [[nodiscard]] TEntry load() const {
+        const U64 d = data.load(std::memory_order_relaxed);
+        return TEntry::fromData(key_xor_data.load(std::memory_order_relaxed) ^ d, d);
+    }
+
+    void store(const TEntry &entry) {
+        const U64 d = entry.data();
+        key_xor_data.store(entry.key ^ d, std::memory_order_relaxed);
+        data.store(d, std::memory_order_relaxed);
+    }
+};
+
+static_assert(sizeof(TSlot) == 16);
+
+// A cache line of entries sharing one index.
+struct alignas(64) TCluster {
+    static constexpr int SIZE = 4;
+    TSlot slots[SIZE];
+};
+
+static_assert(sizeof(TCluster) == 64);
+
+// A saved table is this header followed by the clusters exactly as they are in memory,
+// so loading only maps the file. Entries are in host byte order, the version doesn't
+// match on a host with a different byte order.
+struct TTFileHeader {
+    static constexpr char MAGIC[4] = {'S', 'B', 'T', 'T'};
+    static constexpr uint32_t VERSION = 1;
+
+    char magic[4];
+    uint32_t version;
+    uint32_t slot_size;
+    uint32_t cluster_slots;
+    uint64_t cluster_count;
+    uint8_t generation;
+    uint8_t padding[39];
+};
+
+// keeps the clusters after the header cache line aligned
+static_assert(sizeof(TTFileHeader) == 64);
 
 class TranspositionTable {
    private:
-    std::vector<TEntry> entries_;
+    TCluster *clusters_ = nullptr;
+    U64 cluster_count_ = 0;
+
+    memory::Allocation memory_;
+
+    // threads used to initialize and clear the table
+    int thread_count_ = 1;
+
+    // the clearing threads are bound to the NUMA nodes like the search threads
+    bool numa_binding_ = false;
+
+    // incremented for each new search, stored in the upper 6 bits of gen_bound
+    uint8_t generation_ = 0;
+
+    static constexpr uint8_t GENERATION_DELTA = 1 << 2;
+
+    /// @brief number of searches since the entry was written
+    [[nodiscard]] int relativeAge(const TEntry &tte) const {
+        return static_cast<uint8_t>(generation_ - tte.generation()) / GENERATION_DELTA;
+    }
 
    public:
     TranspositionTable();
+    ~TranspositionTable();
+
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
 
     /// @brief store an entry in the TT
     /// @param depth
@@ -28,20 +123,22 @@ class TranspositionTable {
     /// @param b Type of bound
     /// @param key Position hash
     /// @param move
-    void store(int depth, Score bestvalue, Flag b, U64 key, Move move);
+    /// @param eval Static evaluation, VALUE_NONE keeps the stored one
+    void store(int depth, Score bestvalue, Flag b, U64 key, Move move, Score eval);
 
     /// @brief probe the TT for an entry
-    /// @param tte
     /// @param tt_hit
+    /// @param ttmove
     /// @param key Position hash
-    [[nodiscard]] const TEntry *probe(bool &tt_hit, Move &ttmove, U64 key) const;
+    /// @return a snapshot of the entry, only the eval is valid if tt_hit isn't set
+    [[nodiscard]] TEntry probe(bool &tt_hit, Move &ttmove, U64 key);
 
     /// @brief calculates the TT index of key
     /// @param key
     /// @return
-    [[nodiscard]] uint32_t index(U64 key) const;
+    [[nodiscard]] U64 index(U64 key) const;
 
-    /// @brief allocate Transposition Table and initialize entries_
+    /// @brief allocate size clusters, preferably on huge pages
     void allocate(U64 size);
 
     void allocateMB(U64 size_mb);
@@ -49,13 +146,38 @@ class TranspositionTable {
     /// @brief clear the TT
     void clear();
 
+    /// @brief number of threads clearing the table, every thread first touches
+    /// its own part of the table so the pages are spread over the NUMA nodes it runs on.
+    /// A changed count reallocates the table, pages already touched wouldn't move.
+    void setThreads(int threads);
+
+    /// @brief binds the clearing threads to the NUMA nodes. The table is reallocated,
+    /// only fresh pages are placed on the node of the thread touching them first.
+    void setNumaBinding(bool bind);
+
+    /// @brief writes the table to a file, no search may be running
+    /// @param filename
+    /// @return false if the file couldn't be written
+    bool save(const std::string &filename) const;
+
+    /// @brief replaces the table with a saved one, no search may be running.
+    /// The file is mapped copy on write and its pages are read on first access.
+    /// The table size has to match the current Hash setting.
+    /// @param filename
+    /// @return false if the file couldn't be loaded, the table is unchanged then
+    bool load(const std::string &filename);
+
+    /// @brief ages all entries, called before each search
+    void newSearch() { generation_ += GENERATION_DELTA; }
+
     template <int rw = 0>
     void prefetch(U64 key) const {
-        builtin::prefetch<rw>(&entries_[index(key)]);
+        builtin::prefetch<rw>(&clusters_[index(key)]);
     }
 
+    /// @brief permille of entries written by the current search
     [[nodiscard]] int hashfull() const;
 
-    // 57344 MiB = 2^32 * 14B / (1024 * 1024)
-    static constexpr U64 MAXHASH_MiB = (1ull << 32) * sizeof(TEntry) / (1024 * 1024);
-};
\ No newline at end of file
+    // 32 TiB, the index is 64 bit so this is only limited by the machine
+    static constexpr U64 MAXHASH_MiB = 1ull << 25;
+};
@@ -195,6 +195,8 @@ struct Limits {
     U64 nodes = 0;
     int depth = MAX_PLY - 1;
     bool infinite = false;
+    // go ponder, the time limits only apply after ponderhit
+    bool ponder = false;
 };
 
 /********************
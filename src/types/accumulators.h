@@ -1,23 +1,94 @@
 #pragma once
 
+#include "../builtin.h"
 #include "../types.h"
 
 #include "../nnue.h"
 
+// Caches the last accumulator computed in every king bucket together with the
+// pieces it was computed from. Refreshing a perspective then only applies the
+// difference between those pieces and the current board. The entries stay valid
+// for any position, they are only reset once a different network was loaded.
+struct FinnyTable {
+    // resets all entries to an empty board
+    void clear() {
+        for (auto &entry : entries) {
+            for (auto &half : entry.accumulator) {
+                std::copy(HIDDEN_BIAS, HIDDEN_BIAS + N_HIDDEN_SIZE, half.begin());
+            }
+
+            entry.pieces = {};
+        }
+
+        version = nnue::networkVersion();
+    }
+
+    // refreshes one perspective of acc for the given pieces
+    void refresh(nnue::accumulator &acc, Color perspective, Square ksq,
+                 const std::array<Bitboard, 12> &pieces) {
+        if (version != nnue::networkVersion()) clear();
+
+        Entry &entry = entries[nnue::kingBucket(perspective, ksq)];
+        std::array<Bitboard, 12> &cached = entry.pieces[perspective];
+
+        for (int p = 0; p < 12; p++) {
+            Bitboard added = pieces[p] & ~cached[p];
+            Bitboard removed = cached[p] & ~pieces[p];
+
+            while (added) {
+                const Square sq = builtin::poplsb(added);
+                nnue::update(entry.accumulator, perspective, Piece(p), NO_SQ, sq, ksq);
+            }
+
+            while (removed) {
+                const Square sq = builtin::poplsb(removed);
+                nnue::update(entry.accumulator, perspective, Piece(p), sq, NO_SQ, ksq);
+            }
+
+            cached[p] = pieces[p];
+        }
+
+        acc[perspective] = entry.accumulator[perspective];
+    }
+
+   private:
+    // each perspective only uses its own half of the accumulator
+    struct Entry {
+        nnue::accumulator accumulator;
+        std::array<std::array<Bitboard, 12>, 2> pieces;
+    };
+
+    alignas(64) std::array<Entry, BUCKETS> entries = {};
+
+    // the network the entries were computed with, -1 before the first refresh
+    int version = -1;
+};
+
+// The accumulators are updated lazily, a move only records the changed pieces.
+// Once an evaluation is requested the accumulator is computed from the last
+// computed one on the stack, or refreshed from scratch if the king bucket changed.
 struct Accumulators {
-    Accumulators() { assert(alignof(accumulators) == 32); };
+    Accumulators() { assert(alignof(accumulators) == 64); };
 
     [[nodiscard]] int size() const {
         assert(index >= 0 && index < MAX_PLY + 1);
         return index;
     }
 
-    void clear() { index = 0; }
+    // drops all previous plies, the current accumulator has to be refreshed.
+    // The finny table is kept, refreshing a new position only applies its difference.
+    void clear() {
+        index = 0;
+        computed[0] = {false, false};
+        refresh[0] = {false, false};
+    }
 
     void push() {
         assert(index + 1 < MAX_PLY + 1);
         index++;
-        accumulators[index] = accumulators[index - 1];
+        dirty[index].count = 0;
+        computed[index] = {false, false};
+        refresh[index] = {false, false};
     }
 
     void pop() {
@@ -30,7 +101,44 @@ struct Accumulators {
         return accumulators[index];
     }
 
-private:
-    alignas(32) std::array<nnue::accumulator, MAX_PLY + 1> accumulators = {};
+    void addDirty(Piece piece, Square from_sq, Square to_sq) {
+        assert(dirty[index].count < 3);
+        dirty[index].pieces[dirty[index].count++] = {piece, from_sq, to_sq};
+    }
+
+    // the king of this perspective changed its bucket
+    void markRefresh(Color perspective) { refresh[index][perspective] = true; }
+
+    void markComputed(Color perspective) { computed[index][perspective] = true; }
+
+    [[nodiscard]] bool isComputed(int ply, Color perspective) const {
+        return computed[ply][perspective];
+    }
+
+    [[nodiscard]] bool needsRefresh(int ply, Color perspective) const {
+        return refresh[ply][perspective];
+    }
+
+    // rebuilds one perspective of the current accumulator from the finny table
+    void refreshCurrent(Color perspective, Square ksq, const std::array<Bitboard, 12> &pieces) {
+        finny.refresh(accumulators[index], perspective, ksq, pieces);
+        computed[index][perspective] = true;
+    }
+
+    // computes the accumulator of ply from ply - 1 and its dirty pieces
+    void update(int ply, Color perspective, Square ksq) {
+        assert(ply > 0 && computed[ply - 1][perspective] && !refresh[ply][perspective]);
+
+        nnue::update(accumulators[ply], accumulators[ply - 1], perspective, dirty[ply], ksq);
+
+        computed[ply][perspective] = true;
+    }
+
+   private:
+    alignas(64) std::array<nnue::accumulator, MAX_PLY + 1> accumulators = {};
+    std::array<nnue::DirtyPieces, MAX_PLY + 1> dirty = {};
+    std::array<std::array<bool, 2>, MAX_PLY + 1> computed = {};
+    std::array<std::array<bool, 2>, MAX_PLY + 1> refresh = {};
+    FinnyTable finny;
     int index = 0;
-};
\ No newline at end of file
+};
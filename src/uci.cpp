@@ -6,6 +6,7 @@
 
 #include "cli.h"
 #include "evaluation.h"
+#include "numa.h"
 #include "perft.h"
 #include "str_utils.h"
 #include "thread.h"
@@ -24,15 +25,50 @@ Uci::Uci() {
     options = uci::Options();
     board_ = Board();
 
-    options.add(uci::Option{"Hash", "spin", "16", "16", "1",
-                            std::to_string(UCI_MAX_HASH_MB)});  // Size in MB
-    options.add(uci::Option{"Threads", "spin", "1", "1", "1", "256"});
-    options.add(uci::Option{"EvalFile", "string", "", "", "", ""});
-    options.add(uci::Option{"SyzygyPath", "string", "", "", "", ""});
-    options.add(uci::Option{"UCI_Chess960", "check", "false", "false", "", ""});
+    // Size in MB
+    options.add(uci::Option{"Hash", "spin", "16", "16", "1", std::to_string(UCI_MAX_HASH_MB),
+                            [](const Option& o) { TTable.allocateMB(std::stoull(o.value)); }});
+    options.add(uci::Option{"Threads", "spin", "1", "1", "1", "256", [this](const Option& o) {
+                                worker_threads_ = std::stoi(o.value);
+                                TTable.setThreads(worker_threads_);
+                            }});
+    options.add(uci::Option{"EvalFile", "string", "", "", "", "", [](const Option& o) {
+                                if (o.value.empty()) return;
+
+                                std::cout << "info string EvalFile " << o.value << std::endl;
+                                nnue::init(o.value.c_str());
+                                ECache.clear();
+                            }});
+    // Size in MiB
+    options.add(uci::Option{"EvalCache", "spin", std::to_string(EvalCache::DEFAULT_MB),
+                            std::to_string(EvalCache::DEFAULT_MB), "0",
+                            std::to_string(EvalCache::MAX_MB),
+                            [](const Option& o) { ECache.allocateMB(std::stoi(o.value)); }});
+    options.add(uci::Option{"SyzygyPath", "string", "", "", "", "",
+                            [this](const Option& o) { initSyzygy(o.value); }});
+    options.add(uci::Option{"UCI_Chess960", "check", "false", "false", "", "",
+                            [this](const Option& o) { board_.chess960 = o.value == "true"; }});
     options.add(uci::Option{"UCI_ShowWDL", "check", "false", "false", "", ""});
-
-    applyOptions();
+    options.add(uci::Option{"MultiPV", "spin", "1", "1", "1", "256",
+                            [](const Option& o) { Threads.multipv = std::stoi(o.value); }});
+    options.add(uci::Option{"NumaBind", "check", "false", "false", "", "", [](const Option& o) {
+                                const bool bind = o.value == "true";
+
+                                if (bind)
+                                    std::cout << "info string numa " << numa::describe()
+                                              << std::endl;
+
+                                Threads.setNumaBinding(bind);
+                                TTable.setNumaBinding(bind);
+                            }});
+    options.add(uci::Option{"HelperSkipSize", "spin", "4", "4", "0", "4",
+                            [](const Option& o) { Threads.helper_skip_size = std::stoi(o.value); }});
+    options.add(uci::Option{"PersistentHistory", "check", "false", "false", "", "",
+                            [this](const Option& o) { persistent_history_ = o.value == "true"; }});
+    // the GUI decides when to ponder, the engine only has to announce support
+    options.add(uci::Option{"Ponder", "check", "false", "false", "", ""});
+
+    options.applyAll();
 }
 
 void Uci::uciLoop() {
@@ -77,8 +113,14 @@ void Uci::processLine(const std::string& line) {
         go(line);
     } else if (tokens[0] == "stop") {
         stop();
+    } else if (tokens[0] == "ponderhit") {
+        Threads.ponderhit();
     } else if (tokens[0] == "setoption") {
         setOption(line);
+    } else if (tokens[0] == "savehash" && tokens.size() > 1) {
+        saveHash(line.substr(line.find(' ') + 1));
+    } else if (tokens[0] == "loadhash" && tokens.size() > 1) {
+        loadHash(line.substr(line.find(' ') + 1));
     } else if (tokens[0] == "eval") {
         std::cout << convertScore(eval::evaluate(board_)) << std::endl;
     } else if (tokens[0] == "print") {
@@ -95,42 +137,28 @@ void Uci::uci() {
     std::cout << "uciok" << std::endl;
 }
 
-void Uci::setOption(const std::string& line) {
-    options.set(line);
-    applyOptions();
-}
-
-void Uci::applyOptions() {
-    const auto path = options.get<std::string>("SyzygyPath");
-
-    if (!path.empty()) {
-        if (tb_init(path.c_str())) {
-            use_tb_ = true;
-            std::cout << "info string successfully loaded syzygy path " << path << std::endl;
-        } else {
-            std::cout << "info string failed to load syzygy path " << path << std::endl;
-        }
-    }
+void Uci::setOption(const std::string& line) { options.set(line); }
 
-    const auto eval_file = options.get<std::string>("EvalFile");
+void Uci::initSyzygy(const std::string& path) {
+    if (path.empty()) return;
 
-    if (!eval_file.empty()) {
-        std::cout << "info string EvalFile " << eval_file << std::endl;
-        nnue::init(eval_file.c_str());
+    if (tb_init(path.c_str())) {
+        use_tb_ = true;
+        std::cout << "info string successfully loaded syzygy path " << path << std::endl;
+    } else {
+        std::cout << "info string failed to load syzygy path " << path << std::endl;
     }
-
-    worker_threads_ = options.get<int>("Threads");
-    board_.chess960 = options.get<bool>("UCI_Chess960");
-
-    TTable.allocateMB(options.get<int>("Hash"));
 }
 
 void Uci::isReady() { std::cout << "readyok" << std::endl; }
 
 void Uci::uciNewGame() {
+    // stop the search before its tables are cleared, this also resets the histories
+    Threads.clear();
+
     board_ = Board();
     TTable.clear();
-    Threads.kill();
+    ECache.clear();
 }
 
 void Uci::position(const std::string& line) {
@@ -148,7 +176,7 @@ void Uci::position(const std::string& line) {
         board_.makeMove<false>(uciToMove(board_, move));
     }
 
-    board_.refreshNNUE(board_.getAccumulator());
+    board_.refreshNNUE();
 }
 
 void Uci::go(const std::string& line) {
@@ -162,6 +190,7 @@ void Uci::go(const std::string& line) {
 
     limit.depth = str_util::findElement<int>(tokens, "depth").value_or(MAX_PLY - 1);
     limit.infinite = str_util::findElement<std::string>(tokens, "go").value_or("") == "infinite";
+    limit.ponder = str_util::contains(tokens, "ponder");
     limit.nodes = str_util::findElement<int64_t>(tokens, "nodes").value_or(0);
     limit.time.maximum = limit.time.optimum =
         str_util::findElement<int64_t>(tokens, "movetime").value_or(0);
@@ -189,7 +218,25 @@ void Uci::go(const std::string& line) {
         }
     }
 
-    Threads.start(board_, limit, searchmoves_, worker_threads_, use_tb_);
+    Threads.start(board_, limit, searchmoves_, worker_threads_, use_tb_, persistent_history_);
+}
+
+void Uci::saveHash(const std::string& filename) {
+    Threads.kill();
+
+    if (TTable.save(filename)) {
+        std::cout << "info string saved hash to " << filename << std::endl;
+    } else {
+        std::cout << "info string failed to save hash to " << filename << std::endl;
+    }
+}
+
+void Uci::loadHash(const std::string& filename) {
+    Threads.kill();
+
+    if (TTable.load(filename)) {
+        std::cout << "info string loaded hash from " << filename << std::endl;
+    }
 }
 
 void Uci::stop() { Threads.kill(); }
@@ -302,13 +349,16 @@ std::string wdl(int v, int ply) {
 }
 
 void output(int score, int ply, int depth, uint8_t seldepth, U64 nodes, U64 tbHits, int time,
-            const std::string& pv, int hashfull) {
+            const std::string& pv, int hashfull, int multipv) {
     std::stringstream ss;
 
     // clang-format off
     ss  << "info depth " << signed(depth) 
-        << " seldepth "  << signed(seldepth) 
-        << " score "     << convertScore(score);
+        << " seldepth "  << signed(seldepth);
+
+    if (multipv > 0) ss << " multipv " << multipv;
+
+    ss  << " score "     << convertScore(score);
 
     if (options.get<bool>("UCI_ShowWDL")) {
         ss << " wdl " << wdl(score, ply);
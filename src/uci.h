@@ -17,8 +17,8 @@ class Uci {
 
     void uci();
 
+    /// @brief sets an option, its change handler applies the new value
     void setOption(const std::string& line);
-    void applyOptions();
 
     static void isReady();
 
@@ -27,10 +27,18 @@ class Uci {
 
     void go(const std::string& line);
 
+    /// @brief saves the transposition table to a file, e.g. at the end of a long analysis
+    static void saveHash(const std::string& filename);
+
+    /// @brief restores a table of saveHash, Hash has to be set to the same size
+    static void loadHash(const std::string& filename);
+
     static void stop();
     static void quit();
 
    private:
+    void initSyzygy(const std::string& path);
+
     Board board_;
 
     Movelist searchmoves_;
@@ -38,6 +46,8 @@ class Uci {
     int worker_threads_ = 1;
 
     bool use_tb_ = false;
+
+    bool persistent_history_ = false;
 };
 
 [[nodiscard]] int modelWinRate(int v, int ply);
@@ -48,5 +58,5 @@ class Uci {
 [[nodiscard]] std::string convertScore(int score);
 
 void output(int score, int ply, int depth, uint8_t seldepth, U64 nodes, U64 tbHits, int time,
-            const std::string& pv, int hashfull);
+            const std::string& pv, int hashfull, int multipv = 0);
 }  // namespace uci